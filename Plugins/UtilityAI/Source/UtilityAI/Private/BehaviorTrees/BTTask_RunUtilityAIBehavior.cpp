@@ -0,0 +1,45 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "BehaviorTrees/BTTask_RunUtilityAIBehavior.h"
+
+#include "UtilityAIBehaviorTreeComponent.h"
+#include "BehaviorTree/BehaviorTree.h"
+
+
+UBTTask_RunUtilityAIBehavior::UBTTask_RunUtilityAIBehavior(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	NodeName = "Run Utility AI Behavior";
+
+	bNotifyTaskFinished = true;
+}
+
+EBTNodeResult::Type UBTTask_RunUtilityAIBehavior::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	// behaviors may have been injected before this node was instanced, e.g. while the tree was starting
+	if (const UUtilityAIBehaviorTreeComponent* UtilityBTComp = Cast<UUtilityAIBehaviorTreeComponent>(&OwnerComp))
+	{
+		UBehaviorTree* InjectedBehavior = nullptr;
+		if (UtilityBTComp->FindInjectedBehavior(InjectionTag, InjectedBehavior))
+		{
+			SetBehaviorAsset(InjectedBehavior);
+		}
+	}
+
+	return Super::ExecuteTask(OwnerComp, NodeMemory);
+}
+
+void UBTTask_RunUtilityAIBehavior::OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult)
+{
+	Super::OnTaskFinished(OwnerComp, NodeMemory, TaskResult);
+
+	// aborts are caused by the tree restarting or stopping, which is reported separately
+	if (TaskResult != EBTNodeResult::Aborted)
+	{
+		if (UUtilityAIBehaviorTreeComponent* UtilityBTComp = Cast<UUtilityAIBehaviorTreeComponent>(&OwnerComp))
+		{
+			UtilityBTComp->NotifyInjectedBehaviorFinished(InjectionTag, GetBehaviorAsset());
+		}
+	}
+}
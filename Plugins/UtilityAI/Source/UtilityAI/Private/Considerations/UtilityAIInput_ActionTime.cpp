@@ -0,0 +1,22 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "Considerations/UtilityAIInput_ActionTime.h"
+
+#include "UtilityAIAction.h"
+#include "UtilityAIScoringSnapshot.h"
+
+
+float UUtilityAIInput_ActionTime::GetValue(const FUtilityAIConsiderationContext& Context) const
+{
+	if (!Context.Snapshot)
+	{
+		return 0.f;
+	}
+
+	const FUtilityAIActionState& State = Context.ActionState ? *Context.ActionState : Context.Action.GetState();
+	const float EventTime = Source == EUtilityAIActionTimeSource::SinceExecuted
+		                        ? State.LastExecuteTime
+		                        : State.LastFinishTime;
+	return static_cast<float>(Context.Snapshot->WorldTime) - EventTime;
+}
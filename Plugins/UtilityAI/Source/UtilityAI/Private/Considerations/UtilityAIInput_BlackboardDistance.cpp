@@ -0,0 +1,29 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "Considerations/UtilityAIInput_BlackboardDistance.h"
+
+#include "AIController.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "GameFramework/Pawn.h"
+
+
+float UUtilityAIInput_BlackboardDistance::GetValue(const FUtilityAIConsiderationContext& Context) const
+{
+	const AAIController* AIController = Context.GetAIController();
+	const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr;
+	const UBlackboardComponent* BlackboardComp = AIController ? AIController->GetBlackboardComponent() : nullptr;
+	if (!Pawn || !BlackboardComp)
+	{
+		return DefaultDistance;
+	}
+
+	FVector TargetLocation;
+	if (!BlackboardComp->GetLocationFromEntry(BlackboardComp->GetKeyID(KeyName), TargetLocation))
+	{
+		return DefaultDistance;
+	}
+
+	const FVector PawnLocation = Pawn->GetActorLocation();
+	return bIgnoreZ ? FVector::Dist2D(PawnLocation, TargetLocation) : FVector::Dist(PawnLocation, TargetLocation);
+}
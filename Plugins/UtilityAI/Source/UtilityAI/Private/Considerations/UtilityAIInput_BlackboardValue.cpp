@@ -0,0 +1,57 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "Considerations/UtilityAIInput_BlackboardValue.h"
+
+#include "AIController.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Class.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Enum.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Float.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Int.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+
+
+float UUtilityAIInput_BlackboardValue::GetValue(const FUtilityAIConsiderationContext& Context) const
+{
+	const AAIController* AIController = Context.GetAIController();
+	const UBlackboardComponent* BlackboardComp = AIController ? AIController->GetBlackboardComponent() : nullptr;
+	if (!BlackboardComp)
+	{
+		return 0.f;
+	}
+
+	const FBlackboard::FKey KeyID = BlackboardComp->GetKeyID(KeyName);
+	if (KeyID == FBlackboard::InvalidKey)
+	{
+		return 0.f;
+	}
+
+	const TSubclassOf<UBlackboardKeyType> KeyType = BlackboardComp->GetKeyType(KeyID);
+	if (KeyType == UBlackboardKeyType_Float::StaticClass())
+	{
+		return BlackboardComp->GetValue<UBlackboardKeyType_Float>(KeyID);
+	}
+	if (KeyType == UBlackboardKeyType_Int::StaticClass())
+	{
+		return static_cast<float>(BlackboardComp->GetValue<UBlackboardKeyType_Int>(KeyID));
+	}
+	if (KeyType == UBlackboardKeyType_Enum::StaticClass())
+	{
+		return static_cast<float>(BlackboardComp->GetValue<UBlackboardKeyType_Enum>(KeyID));
+	}
+	if (KeyType == UBlackboardKeyType_Bool::StaticClass())
+	{
+		return BlackboardComp->GetValue<UBlackboardKeyType_Bool>(KeyID) ? 1.f : 0.f;
+	}
+	if (KeyType == UBlackboardKeyType_Object::StaticClass())
+	{
+		return BlackboardComp->GetValue<UBlackboardKeyType_Object>(KeyID) ? 1.f : 0.f;
+	}
+	if (KeyType == UBlackboardKeyType_Class::StaticClass())
+	{
+		return BlackboardComp->GetValue<UBlackboardKeyType_Class>(KeyID) ? 1.f : 0.f;
+	}
+	return 0.f;
+}
@@ -0,0 +1,20 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "Considerations/UtilityAIInput_OwnerTags.h"
+
+#include "UtilityAIScoringSnapshot.h"
+
+
+float UUtilityAIInput_OwnerTags::GetValue(const FUtilityAIConsiderationContext& Context) const
+{
+	if (!Context.Snapshot)
+	{
+		return 0.f;
+	}
+
+	const bool bHasTags = bRequireAll
+		                      ? Context.Snapshot->OwnerTags.HasAll(Tags)
+		                      : Context.Snapshot->OwnerTags.HasAny(Tags);
+	return bHasTags ? 1.f : 0.f;
+}
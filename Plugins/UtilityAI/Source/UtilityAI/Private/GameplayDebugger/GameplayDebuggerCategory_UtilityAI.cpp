@@ -9,13 +9,14 @@
 #include "UtilityAIComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/Pawn.h"
+#include "Math/Float16.h"
 
 
-const FString FGameplayDebuggerCategory_UtilityAI::Status_ActiveBusy("(Active Busy)");
-const FString FGameplayDebuggerCategory_UtilityAI::Status_Active("(Active)");
-const FString FGameplayDebuggerCategory_UtilityAI::Status_TagsNotMet("(Tags Not Met)");
-const FString FGameplayDebuggerCategory_UtilityAI::Status_NoScore("(No Score)");
-const FString FGameplayDebuggerCategory_UtilityAI::Status_Considering("(Considering)");
+namespace UtilityAIGameplayDebugger
+{
+	/** The max time between keyframes, so that clients that missed a keyframe can recover. */
+	constexpr double KeyframeInterval = 2.0;
+}
 
 
 FGameplayDebuggerCategory_UtilityAI::FGameplayDebuggerCategory_UtilityAI()
@@ -23,6 +24,11 @@ FGameplayDebuggerCategory_UtilityAI::FGameplayDebuggerCategory_UtilityAI()
 	SetDataPackReplication<FRepData>(&DataPack);
 }
 
+FGameplayDebuggerCategory_UtilityAI::~FGameplayDebuggerCategory_UtilityAI()
+{
+	SetNameCaptureComponent(nullptr);
+}
+
 TSharedRef<FGameplayDebuggerCategory> FGameplayDebuggerCategory_UtilityAI::MakeInstance()
 {
 	return MakeShareable(new FGameplayDebuggerCategory_UtilityAI());
@@ -30,14 +36,43 @@ TSharedRef<FGameplayDebuggerCategory> FGameplayDebuggerCategory_UtilityAI::MakeI
 
 void FGameplayDebuggerCategory_UtilityAI::FRepData::Serialize(FArchive& Ar)
 {
-	Ar << CompName;
-	Ar << ActionsDesc;
+	Ar << Sequence;
+	Ar << KeyframeSequence;
+	Ar << NumScored;
+	Ar << NumPruned;
+
+	if (IsKeyframe())
+	{
+		Ar << CompName;
+		Ar << Names;
+		Ar << ActionInfos;
+	}
+	else
+	{
+		uint32 NumValues = ValueIndices.Num();
+		Ar.SerializeIntPacked(NumValues);
+		if (Ar.IsLoading())
+		{
+			if (NumValues > MaxSerializedCount)
+			{
+				Ar.SetError();
+				NumValues = 0;
+			}
+			ValueIndices.SetNum(NumValues);
+		}
+		for (uint32& ValueIndex : ValueIndices)
+		{
+			Ar.SerializeIntPacked(ValueIndex);
+		}
+	}
+	Ar << Values;
 }
 
 void FGameplayDebuggerCategory_UtilityAI::CollectData(APlayerController* OwnerPC, AActor* DebugActor)
 {
 	if (!DebugActor)
 	{
+		SetNameCaptureComponent(nullptr);
 		return;
 	}
 
@@ -46,94 +81,207 @@ void FGameplayDebuggerCategory_UtilityAI::CollectData(APlayerController* OwnerPC
 	const TInlineComponentArray<UUtilityAIComponent*> UtilityAIComponents(DebugController);
 	if (UtilityAIComponents.IsEmpty())
 	{
+		SetNameCaptureComponent(nullptr);
 		return;
 	}
 
-	const UUtilityAIComponent* UtilityAI = UtilityAIComponents[0];
+	UUtilityAIComponent* UtilityAI = UtilityAIComponents[0];
+	SetNameCaptureComponent(UtilityAI);
 
-	DataPack.CompName = UtilityAI->GetReadableName();
+	const int32 NumActions = UtilityAI->GetNumActions();
+	const bool bIsBusy = UtilityAI->IsBusy();
 
-	// add all actions and their scores
-	TArray<UUtilityAIAction*> AllActions = UtilityAI->GetAllActions();
-	AllActions.Sort([](const UUtilityAIAction& A, const UUtilityAIAction& B)
+	if (KeyframeComponent != UtilityAI)
 	{
-		return A.ScoreWeight > B.ScoreWeight;
-	});
+		NameIndices.Reset();
+		Names.Reset();
+	}
+	const int32 NumNames = Names.Num();
 
-	// normalize bars to max score
-	float MaxScore = 1.f;
-	for (const UUtilityAIAction* Action : AllActions)
+	bool bIsKeyframe = KeyframeComponent != UtilityAI || KeyframeInfos.Num() != NumActions ||
+		FPlatformTime::Seconds() - LastKeyframeTime >= UtilityAIGameplayDebugger::KeyframeInterval;
+
+	CollectedValues.SetNum(NumActions);
+	for (int32 Idx = 0; Idx < NumActions; ++Idx)
 	{
-		MaxScore = FMath::Max(MaxScore, Action->ScoreWeight);
+		if (!bIsKeyframe)
+		{
+			const FActionInfo Info{GetNameIndex(UtilityAI->GetActionClass(Idx)->GetFName()), UtilityAI->GetActionScoreWeight(Idx)};
+			bIsKeyframe = !(Info == KeyframeInfos[Idx]);
+		}
+		CollectActionValues(*UtilityAI, Idx, bIsBusy, CollectedValues[Idx]);
 	}
 
-	TArray<FString> Lines;
-	for (const UUtilityAIAction* Action : AllActions)
+	// new names are only sent in keyframes
+	bIsKeyframe |= Names.Num() != NumNames;
+
+	const FUtilityAISelectionStats SelectionStats = UtilityAI->GetSelectionStats();
+	if (!bIsKeyframe && CollectedValues == LastValues &&
+		SelectionStats.NumScored == DataPack.NumScored && SelectionStats.NumPruned == DataPack.NumPruned)
 	{
-		FString Name = Action->GetClass()->GetName();
-		Name.RemoveFromEnd(TEXT("_C"));
+		// leave the pack unchanged, so it isn't replicated again
+		return;
+	}
 
-		// determine the status of the action.
-		FString ExecutingStr("       ");
-		FString Status;
-		if (Action->IsExecuting())
-		{
-			ExecutingStr = TEXT(">>>");
-			if (UtilityAI->IsBusy())
-			{
-				Status = Status_ActiveBusy;
-			}
-			else
-			{
-				Status = Status_Active;
-			}
-		}
-		else if (!Action->AreTagRequirementsMet())
-		{
-			Status = Status_TagsNotMet;
-		}
-		else if (Action->GetScore() <= UE_SMALL_NUMBER)
+	++DataPack.Sequence;
+	DataPack.NumScored = SelectionStats.NumScored;
+	DataPack.NumPruned = SelectionStats.NumPruned;
+	DataPack.ValueIndices.Reset();
+
+	if (bIsKeyframe)
+	{
+		KeyframeComponent = UtilityAI;
+		LastKeyframeTime = FPlatformTime::Seconds();
+		KeyframeInfos.SetNum(NumActions);
+		for (int32 Idx = 0; Idx < NumActions; ++Idx)
 		{
-			Status = Status_NoScore;
+			KeyframeInfos[Idx] = {GetNameIndex(UtilityAI->GetActionClass(Idx)->GetFName()), UtilityAI->GetActionScoreWeight(Idx)};
 		}
-		else
+		KeyframeValues = CollectedValues;
+
+		DataPack.KeyframeSequence = DataPack.Sequence;
+		DataPack.CompName = UtilityAI->GetReadableName();
+		DataPack.Names = Names;
+		DataPack.ActionInfos = KeyframeInfos;
+		DataPack.Values = CollectedValues;
+	}
+	else
+	{
+		DataPack.CompName.Reset();
+		DataPack.Names.Reset();
+		DataPack.ActionInfos.Reset();
+		DataPack.Values.Reset();
+		for (int32 Idx = 0; Idx < CollectedValues.Num(); ++Idx)
 		{
-			Status = Status_Considering;
+			if (CollectedValues[Idx] != KeyframeValues[Idx])
+			{
+				DataPack.ValueIndices.Add(Idx);
+				DataPack.Values.Add(CollectedValues[Idx]);
+			}
 		}
+	}
+
+	LastValues = CollectedValues;
+
+	if (IsCategoryLocal())
+	{
+		// the pack isn't replicated to a local debugger
+		ApplyDataPack();
+	}
+}
+
+uint32 FGameplayDebuggerCategory_UtilityAI::GetNameIndex(FName Name)
+{
+	if (Names.IsEmpty())
+	{
+		NameIndices.Add(NAME_None, 0);
+		Names.Add(FString());
+	}
+
+	if (const uint32* Index = NameIndices.Find(Name))
+	{
+		return *Index;
+	}
+
+	const uint32 Index = Names.Add(Name.ToString());
+	NameIndices.Add(Name, Index);
+	return Index;
+}
+
+void FGameplayDebuggerCategory_UtilityAI::CollectActionValues(const UUtilityAIComponent& UtilityAI, int32 ActionIdx, bool bIsBusy,
+                                                              FActionValues& OutValues)
+{
+	// actions may not have an instance, so read their state through the component
+	const FUtilityAIActionState& State = UtilityAI.GetAllActionStates()[ActionIdx];
+	if (State.bIsExecuting)
+	{
+		OutValues.Status = bIsBusy ? EActionStatus::ActiveBusy : EActionStatus::Active;
+	}
+	else if (!UtilityAI.AreActionTagRequirementsMet(ActionIdx))
+	{
+		OutValues.Status = EActionStatus::TagsNotMet;
+	}
+	else if (State.Score <= UE_SMALL_NUMBER)
+	{
+		OutValues.Status = EActionStatus::NoScore;
+	}
+	else
+	{
+		OutValues.Status = EActionStatus::Considering;
+	}
 
-		const FUtilityAIScoringElements& ScoringElements = Action->GetScoringElements();
+	const float ScoreWeight = UtilityAI.GetActionScoreWeight(ActionIdx);
+	const float ScoreFraction = ScoreWeight > 0.f ? State.Score / ScoreWeight : 0.f;
+	OutValues.QuantizedScore = static_cast<uint16>(FMath::RoundToInt32(FMath::Clamp(ScoreFraction, 0.f, 1.f) * MAX_uint16));
+
+	const FUtilityAIScoringElements& ScoringElements = UtilityAI.GetActionScoringElements(ActionIdx);
+	OutValues.Operation = ScoringElements.Operation;
+	OutValues.NumSkipped = static_cast<uint8>(FMath::Min(ScoringElements.NumSkipped, static_cast<int32>(MAX_uint8)));
+
+	// elements aren't shown for actions that can't be selected
+	const int32 NumElements = OutValues.Status == EActionStatus::TagsNotMet ? 0 : ScoringElements.Scores.Num();
+	OutValues.ElementNameIndices.SetNum(NumElements);
+	OutValues.ElementScores.SetNum(NumElements);
+	for (int32 Idx = 0; Idx < NumElements; ++Idx)
+	{
+		OutValues.ElementNameIndices[Idx] = GetNameIndex(ScoringElements.GetName(Idx));
+		OutValues.ElementScores[Idx] = FFloat16(ScoringElements.Scores[Idx]).Encoded;
+	}
+}
 
-		// show action name and state: ">>> My Action (BUSY)
-		FString ActionLine = FString::Printf(TEXT("%s %s %s"), *ExecutingStr, *Name, *Status);
-		Lines.Add(ActionLine);
+void FGameplayDebuggerCategory_UtilityAI::OnDataPackReplicated(int32 DataPackId)
+{
+	ApplyDataPack();
+}
 
-		if (!Action->AreTagRequirementsMet())
+void FGameplayDebuggerCategory_UtilityAI::ApplyDataPack()
+{
+	if (DataPack.IsKeyframe())
+	{
+		AppliedKeyframe = DataPack;
+		bHasAppliedKeyframe = true;
+		AppliedValues = DataPack.Values;
+	}
+	else if (bHasAppliedKeyframe && DataPack.KeyframeSequence == AppliedKeyframe.Sequence)
+	{
+		AppliedValues = AppliedKeyframe.Values;
+		for (int32 Idx = 0; Idx < DataPack.ValueIndices.Num() && Idx < DataPack.Values.Num(); ++Idx)
 		{
-			continue;
+			const uint32 ValueIndex = DataPack.ValueIndices[Idx];
+			if (AppliedValues.IsValidIndex(ValueIndex))
+			{
+				AppliedValues[ValueIndex] = DataPack.Values[Idx];
+			}
 		}
+	}
+	else
+	{
+		// the keyframe was missed, keep drawing the last values until the next one
+		return;
+	}
 
-		// add score meter: "[||||       ] [12.0 / 20.0]"
-		const FString ScoreStr = FString::Printf(TEXT("%.2f / %.2f"), Action->GetScore(), Action->ScoreWeight);
-		const FString ScoreBarStr = FormatScoreBar(Action->GetScore(), Action->ScoreWeight, MaxScore);
-		const FString OperationStr = StaticEnum<EUtilityAIScoreOperation>()->GetNameStringByValue(static_cast<int64>(ScoringElements.Operation));
-		const FString ScoreBarLine = FString::Printf(TEXT("\t\t%s [%s] (%s)"), *ScoreBarStr, *ScoreStr, *OperationStr);
-		Lines.Add(ScoreBarLine);
+	AppliedNumScored = DataPack.NumScored;
+	AppliedNumPruned = DataPack.NumPruned;
+}
 
-		// display element scores
-		const int32 ActionScoreBarWidth = FMath::CeilToInt((Action->ScoreWeight / MaxScore) * 100);
-		for (int32 ElementIdx = 0; ElementIdx < ScoringElements.Scores.Num(); ++ElementIdx)
-		{
-			check(ScoringElements.Names.IsValidIndex(ElementIdx));
+void FGameplayDebuggerCategory_UtilityAI::SetNameCaptureComponent(UUtilityAIComponent* Component)
+{
+	if (NameCaptureComponent.Get() == Component)
+	{
+		return;
+	}
 
-			const float ElementScore = ScoringElements.Scores[ElementIdx];
-			const FString ElementName = ScoringElements.Names[ElementIdx];
+	if (NameCaptureComponent.IsValid())
+	{
+		NameCaptureComponent->bCaptureScoreNames = false;
+	}
 
-			const FString ElemScoreBarStr = FormatProgressBar(ElementScore, ActionScoreBarWidth, '\'');
-			FString ElemScoreLine = FString::Printf(TEXT("\t\t%s [%.2f] %s"), *ElemScoreBarStr, ElementScore, *ElementName);
-			Lines.Add(ElemScoreLine);
-		}
+	NameCaptureComponent = Component;
+
+	if (Component)
+	{
+		Component->bCaptureScoreNames = true;
 	}
-	DataPack.ActionsDesc = FString::Join(Lines, TEXT("\n"));
 }
 
 void FGameplayDebuggerCategory_UtilityAI::DrawData(APlayerController* OwnerPC, FGameplayDebuggerCanvasContext& CanvasContext)
@@ -160,39 +308,98 @@ void FGameplayDebuggerCategory_UtilityAI::DrawData(APlayerController* OwnerPC, F
 	CanvasContext.CursorY += CanvasContext.GetLineHeight() * 0.5f;
 
 
-	CanvasContext.Printf(TEXT("Utility Component: {yellow}%s"), *DataPack.CompName);
+	CanvasContext.Printf(TEXT("Utility Component: {yellow}%s"), *AppliedKeyframe.CompName);
 
 	CanvasContext.Printf(TEXT("Actions:"));
-	TArray<FString> ActionLines;
-	DataPack.ActionsDesc.ParseIntoArrayLines(ActionLines, true);
+	CanvasContext.Printf(TEXT("{white}Scored: %d, Pruned: %d"), AppliedNumScored, AppliedNumPruned);
+
+	const TArray<FString>& PackNames = AppliedKeyframe.Names;
+	const TArray<FActionInfo>& ActionInfos = AppliedKeyframe.ActionInfos;
+	const int32 NumActions = FMath::Min(ActionInfos.Num(), AppliedValues.Num());
+	auto GetPackName = [&PackNames](uint32 Index) -> const FString&
+	{
+		static const FString NoName;
+		return PackNames.IsValidIndex(Index) ? PackNames[Index] : NoName;
+	};
+
+	// show actions by descending weight, and normalize bars to the max score
+	TArray<int32, TInlineAllocator<64>> SortedIndices;
+	float MaxScore = 1.f;
+	for (int32 Idx = 0; Idx < NumActions; ++Idx)
+	{
+		SortedIndices.Add(Idx);
+		MaxScore = FMath::Max(MaxScore, ActionInfos[Idx].ScoreWeight);
+	}
+	SortedIndices.StableSort([&ActionInfos](int32 A, int32 B)
+	{
+		return ActionInfos[A].ScoreWeight > ActionInfos[B].ScoreWeight;
+	});
 
-	FString ColorStr = TEXT("{white}");
-	for (int32 Idx = 0; Idx < ActionLines.Num(); ++Idx)
+	for (const int32 ActionIdx : SortedIndices)
 	{
-		const FString& Line = ActionLines[Idx];
+		const FActionInfo& Info = ActionInfos[ActionIdx];
+		const FActionValues& Values = AppliedValues[ActionIdx];
+
+		FString Name = GetPackName(Info.NameIndex);
+		Name.RemoveFromEnd(TEXT("_C"));
 
-		if (Line.Contains(Status_ActiveBusy))
+		const TCHAR* ColorStr = TEXT("{white}");
+		const TCHAR* ExecutingStr = TEXT("       ");
+		const TCHAR* StatusStr = TEXT("(Considering)");
+		switch (Values.Status)
 		{
+		case EActionStatus::ActiveBusy:
 			ColorStr = TEXT("{cyan}");
-		}
-		else if (Line.Contains(Status_Active))
-		{
+			ExecutingStr = TEXT(">>>");
+			StatusStr = TEXT("(Active Busy)");
+			break;
+		case EActionStatus::Active:
 			ColorStr = TEXT("{green}");
-		}
-		else if (Line.Contains(Status_TagsNotMet))
-		{
+			ExecutingStr = TEXT(">>>");
+			StatusStr = TEXT("(Active)");
+			break;
+		case EActionStatus::TagsNotMet:
 			ColorStr = TEXT("{red}");
+			StatusStr = TEXT("(Tags Not Met)");
+			break;
+		case EActionStatus::NoScore:
+			ColorStr = TEXT("{grey}");
+			StatusStr = TEXT("(No Score)");
+			break;
+		default:
+			break;
 		}
-		else if (Line.Contains(Status_NoScore))
+
+		// show action name and state: ">>> My Action (Active Busy)"
+		CanvasContext.Printf(TEXT("%s%s %s %s"), ColorStr, ExecutingStr, *Name, StatusStr);
+
+		if (Values.Status == EActionStatus::TagsNotMet)
 		{
-			ColorStr = TEXT("{grey}");
+			continue;
 		}
-		else if (Line.Contains(Status_Considering))
+
+		// add score meter: "[||||       ] [12.0 / 20.0]"
+		const float Score = Values.QuantizedScore / static_cast<float>(MAX_uint16) * Info.ScoreWeight;
+		const FString ScoreBarStr = FormatScoreBar(Score, Info.ScoreWeight, MaxScore);
+		const FString OperationStr = StaticEnum<EUtilityAIScoreOperation>()->GetNameStringByValue(static_cast<int64>(Values.Operation));
+		CanvasContext.Printf(TEXT("%s\t\t%s [%.2f / %.2f] (%s)"), ColorStr, *ScoreBarStr, Score, Info.ScoreWeight, *OperationStr);
+
+		// display element scores
+		const int32 ActionScoreBarWidth = FMath::CeilToInt((Info.ScoreWeight / MaxScore) * 100);
+		for (int32 ElementIdx = 0; ElementIdx < Values.ElementScores.Num(); ++ElementIdx)
 		{
-			ColorStr = TEXT("{white}");
+			FFloat16 ElementScore;
+			ElementScore.Encoded = Values.ElementScores[ElementIdx];
+
+			const FString ElemScoreBarStr = FormatProgressBar(static_cast<float>(ElementScore), ActionScoreBarWidth, '\'');
+			CanvasContext.Printf(TEXT("%s\t\t%s [%.2f] %s"), ColorStr, *ElemScoreBarStr, static_cast<float>(ElementScore),
+			                     *GetPackName(Values.ElementNameIndices[ElementIdx]));
 		}
 
-		CanvasContext.Printf(TEXT("%s%s"), *ColorStr, *Line);
+		if (Values.NumSkipped > 0)
+		{
+			CanvasContext.Printf(TEXT("%s\t\t(%d skipped)"), ColorStr, Values.NumSkipped);
+		}
 	}
 
 	// small padding
@@ -6,42 +6,201 @@
 
 #include "CoreMinimal.h"
 #include "GameplayDebuggerCategory.h"
+#include "UtilityAITypes.h"
 
+class UUtilityAIComponent;
 
 /**
  * Gameplay debugger category for Utility AI
+ *
+ * Replicates a compact binary pack of action scores, which is only formatted into text by the drawing client.
+ * A keyframe containing names and weights is sent when the debugged component or its actions change, and
+ * periodically so that clients can recover from missed packs. Other packs only contain the actions whose
+ * values changed since the keyframe, and no pack is sent at all while nothing changes.
  */
 class FGameplayDebuggerCategory_UtilityAI : public FGameplayDebuggerCategory
 {
 public:
 	FGameplayDebuggerCategory_UtilityAI();
+	virtual ~FGameplayDebuggerCategory_UtilityAI() override;
 
 	static TSharedRef<FGameplayDebuggerCategory> MakeInstance();
 	virtual void CollectData(APlayerController* OwnerPC, AActor* DebugActor) override;
 	virtual void DrawData(APlayerController* OwnerPC, FGameplayDebuggerCanvasContext& CanvasContext) override;
+	virtual void OnDataPackReplicated(int32 DataPackId) override;
 
 	static FString FormatScoreBar(float Score, float ScoreWeight, float MaxScore);
 	static FString FormatProgressBar(float Percent, int32 BarWidth, TCHAR Char = '|');
 
 protected:
-	static const FString Status_ActiveBusy;
-	static const FString Status_Active;
-	static const FString Status_TagsNotMet;
-	static const FString Status_NoScore;
-	static const FString Status_Considering;
+	/** The max number of elements or value indices read from a data pack, so corrupt packs can't allocate arbitrarily. */
+	static constexpr uint32 MaxSerializedCount = 4096;
+
+	enum class EActionStatus : uint8
+	{
+		Considering,
+		NoScore,
+		TagsNotMet,
+		Active,
+		ActiveBusy,
+	};
+
+	/** The static information about an action, only sent in keyframes. */
+	struct FActionInfo
+	{
+		/** The index of the action's class name in the name table. */
+		uint32 NameIndex = 0;
+		float ScoreWeight = 0.f;
+
+		bool operator==(const FActionInfo& Other) const
+		{
+			return NameIndex == Other.NameIndex && ScoreWeight == Other.ScoreWeight;
+		}
+
+		friend FArchive& operator<<(FArchive& Ar, FActionInfo& Info)
+		{
+			Ar.SerializeIntPacked(Info.NameIndex);
+			Ar << Info.ScoreWeight;
+			return Ar;
+		}
+	};
+
+	/** The current values of an action. */
+	struct FActionValues
+	{
+		EActionStatus Status = EActionStatus::Considering;
+
+		/** The score as a fraction of the score weight. */
+		uint16 QuantizedScore = 0;
+
+		EUtilityAIScoreOperation Operation = EUtilityAIScoreOperation::Multiply;
+
+		uint8 NumSkipped = 0;
+
+		/** The index of each scoring element's name in the name table. */
+		TArray<uint32> ElementNameIndices;
+
+		/** The scoring element scores, as half precision floats. */
+		TArray<uint16> ElementScores;
+
+		bool operator==(const FActionValues& Other) const
+		{
+			return Status == Other.Status && QuantizedScore == Other.QuantizedScore && Operation == Other.Operation &&
+				NumSkipped == Other.NumSkipped && ElementNameIndices == Other.ElementNameIndices && ElementScores == Other.ElementScores;
+		}
+
+		bool operator!=(const FActionValues& Other) const { return !(*this == Other); }
+
+		friend FArchive& operator<<(FArchive& Ar, FActionValues& Values)
+		{
+			Ar << Values.Status;
+			Ar << Values.QuantizedScore;
+			Ar << Values.Operation;
+			Ar << Values.NumSkipped;
+
+			uint32 NumElements = Values.ElementScores.Num();
+			Ar.SerializeIntPacked(NumElements);
+			if (Ar.IsLoading())
+			{
+				if (NumElements > MaxSerializedCount)
+				{
+					Ar.SetError();
+					NumElements = 0;
+				}
+				Values.ElementNameIndices.SetNum(NumElements);
+				Values.ElementScores.SetNum(NumElements);
+			}
+			for (uint32 Idx = 0; Idx < NumElements; ++Idx)
+			{
+				Ar.SerializeIntPacked(Values.ElementNameIndices[Idx]);
+				Ar << Values.ElementScores[Idx];
+			}
+			return Ar;
+		}
+	};
 
 	struct FRepData
 	{
+		uint16 Sequence = 0;
+
+		/** The keyframe that this pack's values are relative to. Equal to Sequence for keyframes. */
+		uint16 KeyframeSequence = 0;
+
+		int32 NumScored = 0;
+		int32 NumPruned = 0;
+
+		// only sent in keyframes
 		FString CompName;
-		FString ActionsDesc;
+		TArray<FString> Names;
+		TArray<FActionInfo> ActionInfos;
+
+		/** For keyframes, the values of all actions. Otherwise only the values that changed since the keyframe. */
+		TArray<FActionValues> Values;
+
+		/** The index of each entry in Values, when not a keyframe. */
+		TArray<uint32> ValueIndices;
+
+		bool IsKeyframe() const { return Sequence == KeyframeSequence; }
 
 		void Serialize(FArchive& Ar);
 	};
 
 	FRepData DataPack;
 
+	// collecting state
+
+	/** The component the last keyframe was collected from. */
+	TWeakObjectPtr<UUtilityAIComponent> KeyframeComponent;
+
+	/** The time the last keyframe was collected. */
+	double LastKeyframeTime = 0.0;
+
+	/** Names referenced by action infos and values. Index 0 is always None. */
+	TMap<FName, uint32> NameIndices;
+
+	/** The names in NameIndices, by index. */
+	TArray<FString> Names;
+
+	TArray<FActionInfo> KeyframeInfos;
+
+	TArray<FActionValues> KeyframeValues;
+
+	/** The values sent in the last pack, used to skip sending packs when nothing has changed. */
+	TArray<FActionValues> LastValues;
+
+	/** The values being collected, reused between collections. */
+	TArray<FActionValues> CollectedValues;
+
+	/** Return the index of a name in the name table, adding it if needed. */
+	uint32 GetNameIndex(FName Name);
+
+	/** Fill in the values of an action. */
+	void CollectActionValues(const UUtilityAIComponent& UtilityAI, int32 ActionIdx, bool bIsBusy, FActionValues& OutValues);
+
+	// drawing state
+
+	/** The last keyframe that was applied, which deltas are applied to. */
+	FRepData AppliedKeyframe;
+
+	bool bHasAppliedKeyframe = false;
+
+	/** The current values of all actions, after applying the latest pack. */
+	TArray<FActionValues> AppliedValues;
+
+	int32 AppliedNumScored = 0;
+	int32 AppliedNumPruned = 0;
+
+	/** Apply the data pack to the drawn state. */
+	void ApplyDataPack();
+
 	/** The height of the drawn text during the last update, for drawing a background this update. */
 	float LastDrawDataHeight = 0.0f;
+
+	/** The component currently capturing scoring element names for this debugger. */
+	TWeakObjectPtr<UUtilityAIComponent> NameCaptureComponent;
+
+	/** Capture scoring element names only for the debugged component. */
+	void SetNameCaptureComponent(UUtilityAIComponent* Component);
 };
 
 #endif
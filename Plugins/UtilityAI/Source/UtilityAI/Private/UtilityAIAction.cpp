@@ -5,27 +5,70 @@
 
 #include "AIController.h"
 #include "GameplayTagAssetInterface.h"
+#include "UtilityAIActionDefinition.h"
 #include "UtilityAIModule.h"
 #include "UtilityAIComponent.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIScoringSnapshot.h"
+#include "UtilityAIStats.h"
+#include "UtilityAIStatics.h"
 #include "Engine/World.h"
 
 
-TAutoConsoleVariable<bool> CVarDebugCalculateScores(
-	TEXT("ai.Utility.DebugCalculateScores"),
+TAutoConsoleVariable<bool> CVarMeasureConsiderationCost(
+	TEXT("ai.Utility.MeasureConsiderationCost"),
 	false,
-	TEXT("Always calculate scores for debugging purposes, even for actions that cannot execute."));
+	TEXT("Measure the cost of each consideration, and evaluate the cheapest ones first instead of using their declared cost."));
+
+/** The number of data score calculations between sorting considerations by their measured cost. */
+static constexpr int32 ConsiderationSortInterval = 64;
 
 
 UUtilityAIAction::UUtilityAIAction(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
-	bHasBlueprintInitialize = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Initialize_BP));
-	bHasBlueprintDeinitialize = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Deinitialize_BP));
-	bHasBlueprintCalculateElementScores = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, CalculateElementScores_BP));
-	bHasBlueprintCalculateScore = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, CalculateScore_BP));
-	bHasBlueprintExecute = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Execute_BP));
-	bHasBlueprintAbort = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Abort_BP));
-	bHasBlueprintOnFinished = GetClass()->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, OnFinished_BP));
+}
+
+const FUtilityAIActionDefinition& UUtilityAIAction::GetDefinition() const
+{
+	if (!Definition)
+	{
+		Definition = &FUtilityAIActionDefinition::Get(GetClass());
+	}
+	return *Definition;
+}
+
+const FUtilityAIActionState& UUtilityAIAction::GetState() const
+{
+	const UUtilityAIComponent* AIComp = GetAIComponent();
+	if (AIComp && AIComp->ActionStates.IsValidIndex(ActionIndex))
+	{
+		return AIComp->ActionStates[ActionIndex];
+	}
+
+	// not created by a component, or already removed from it
+	return DetachedState;
+}
+
+FUtilityAIActionState& UUtilityAIAction::GetMutableState()
+{
+	UUtilityAIComponent* AIComp = GetAIComponent();
+	if (AIComp && AIComp->ActionStates.IsValidIndex(ActionIndex))
+	{
+		return AIComp->ActionStates[ActionIndex];
+	}
+
+	return DetachedState;
+}
+
+void UUtilityAIAction::UpdateDeprecatedProperties()
+{
+	const FUtilityAIActionState& State = GetState();
+	Score = State.Score;
+	bIsScoreFrozen = State.bIsScoreFrozen;
+	ExecuteCount = State.ExecuteCount;
+	LastExecuteTime = State.LastExecuteTime;
+	LastFinishTime = State.LastFinishTime;
 }
 
 UUtilityAIComponent* UUtilityAIAction::GetAIComponent() const
@@ -60,137 +103,222 @@ UWorld* UUtilityAIAction::GetWorld() const
 	return nullptr;
 }
 
+const FUtilityAIScoringSnapshot* UUtilityAIAction::GetScoringSnapshot() const
+{
+	if (const UUtilityAIComponent* AIComp = GetAIComponent())
+	{
+		return AIComp->GetScoringSnapshot();
+	}
+	return nullptr;
+}
+
 bool UUtilityAIAction::CanCalculateScore() const
 {
 	return !IsScoreFrozen();
 }
 
-void UUtilityAIAction::UpdateScore()
+bool UUtilityAIAction::UpdateScore(float ScoreToBeat)
 {
-	bool bShouldCalcScore = AreTagRequirementsMet() && CanCalculateScore();
-
-#if WITH_GAMEPLAY_DEBUGGER
-	// allow calculating the score all the time, but only store the scoring elements,
-	// don't update the actual score when debugging
-	const bool bDebugCalcScore = CVarDebugCalculateScores.GetValueOnAnyThread();
-	const bool bIsDebugOnlyCalculation = !bShouldCalcScore && bDebugCalcScore;
-	bShouldCalcScore |= bDebugCalcScore;
-#endif
+	UUtilityAIComponent* AIComp = GetAIComponent();
+	return AIComp && AIComp->Actions.IsValidIndex(ActionIndex) && AIComp->UpdateActionScore(ActionIndex, ScoreToBeat);
+}
 
-	if (!bShouldCalcScore)
-	{
-		return;
-	}
+bool UUtilityAIAction::DependsOnTags(const FGameplayTagContainer& Tags) const
+{
+	return Tags.HasAny(RequireTags) || Tags.HasAny(IgnoreTags) || Tags.HasAny(DependencyTags) ||
+		(!TagQuery.IsEmpty() && !Tags.IsEmpty());
+}
 
-	ScoringElements.Reset();
-	const float NewScore = CalculateScore();
+bool UUtilityAIAction::ReadsScoringSnapshot() const
+{
+	return (ScoringMethod == EUtilityAIScoringMethod::Data && !Considerations.IsEmpty()) ||
+		!RequireTags.IsEmpty() || !IgnoreTags.IsEmpty() || !TagQuery.IsEmpty() || bScoreOnlyWhenDirty;
+}
 
-#if WITH_GAMEPLAY_DEBUGGER
-	if (!bIsDebugOnlyCalculation)
-#endif
+bool UUtilityAIAction::IsScoringThreadSafe() const
+{
+	switch (ScoringMethod)
 	{
-		Score = NewScore;
+	case EUtilityAIScoringMethod::Data:
+		// measuring re-sorts the considerations of the shared definition, which only happens on the game thread
+		return GetDefinition().bAreConsiderationsThreadSafe && HasDefaultConsiderations() &&
+			!CVarMeasureConsiderationCost.GetValueOnAnyThread();
+	case EUtilityAIScoringMethod::Function:
+		return GetDefinition().bIsCustomScoringThreadSafe;
+	default:
+		return false;
 	}
 }
 
-float UUtilityAIAction::CalculateScore()
+float UUtilityAIAction::CalculateScore(float ScoreToBeat)
+{
+	return CalculateScore(ScoreToBeat, ScoringElements);
+}
+
+float UUtilityAIAction::CalculateScore(float ScoreToBeat, FUtilityAIScoringElements& OutElements, const FUtilityAIActionState* InState)
 {
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_UpdateScore);
+	UTILITYAI_TRACE_ACTION_SCOPE(*this);
+
 	switch (ScoringMethod)
 	{
 	case EUtilityAIScoringMethod::Data:
-		return CalculateDataScore() * ScoreWeight;
+		{
+			const FUtilityAIConsiderationContext Context(*this, GetScoringSnapshot(), InState ? InState : &GetState());
+			return CalculateDataScore(Context, ScoreWeight, ScoreToBeat, OutElements) * ScoreWeight;
+		}
 	case EUtilityAIScoringMethod::Function:
-		return CalculateCustomScore() * ScoreWeight;
+		return CalculateCustomScoreElements(OutElements) * ScoreWeight;
 	default:
 		return 0.f;
 	}
 }
 
-float UUtilityAIAction::CalculateDataScore()
+float UUtilityAIAction::CalculateDataScore(const FUtilityAIConsiderationContext& Context, float InScoreWeight, float ScoreToBeat,
+                                           FUtilityAIScoringElements& OutElements) const
 {
-	// TODO: implement
-	return 0.f;
-}
+	const FUtilityAIActionDefinition& ActionDefinition = GetDefinition();
 
-float UUtilityAIAction::CalculateCustomScore()
-{
-	if (bHasBlueprintCalculateElementScores)
+	// instances that changed their considerations at runtime evaluate them in the order they're declared
+	const bool bUseSortedOrder = HasDefaultConsiderations();
+	const bool bMeasureCost = bUseSortedOrder && CVarMeasureConsiderationCost.GetValueOnAnyThread() && IsInGameThread();
+	if (bMeasureCost && ++ActionDefinition.NumCalculationsSinceSort >= ConsiderationSortInterval)
 	{
-		TArray<FUtilityAIScore> Elements;
-		EUtilityAIScoreOperation Operation;
-		CalculateElementScores_BP(Elements, Operation);
+		ActionDefinition.SortConsiderationsByCost(true);
+	}
 
-		// TODO: once data driven, early out when we hit a score that guarantees 0, to only calculate whats needed
+	const int32 NumToEvaluate = bUseSortedOrder ? ActionDefinition.ConsiderationOrder.Num() : Considerations.Num();
 
-		// register the scores and desired operation
-		for (const FUtilityAIScore& Element : Elements)
+	OutElements.Operation = ConsiderationOperation;
+	FUtilityAIScoreCombiner Combiner(ConsiderationOperation, InScoreWeight, ScoreToBeat);
+
+	for (int32 OrderIdx = 0; OrderIdx < NumToEvaluate; ++OrderIdx)
+	{
+		const int32 ConsiderationIdx = bUseSortedOrder ? ActionDefinition.ConsiderationOrder[OrderIdx] : OrderIdx;
+		const UUtilityAIConsideration* Consideration = Considerations.IsValidIndex(ConsiderationIdx) ? Considerations[ConsiderationIdx].Get() : nullptr;
+		if (!Consideration)
 		{
-			ScoringElements.AddScore(Element);
+			// entries can be cleared in the editor without changing the number of considerations
+			continue;
 		}
-		ScoringElements.Operation = Operation;
 
-		// calculate the result
-		return CombineScores(ScoringElements.Scores, ScoringElements.Operation);
-	}
+		float ElementScore;
+		if (bMeasureCost)
+		{
+			const uint32 StartCycles = FPlatformTime::Cycles();
+			ElementScore = Consideration->Evaluate(Context);
+			const float Cycles = static_cast<float>(FPlatformTime::Cycles() - StartCycles);
 
-	if (bHasBlueprintCalculateScore)
-	{
-		return CalculateScore_BP();
+			float& AverageCost = ActionDefinition.MeasuredConsiderationCosts[ConsiderationIdx];
+			AverageCost = AverageCost > 0.f ? FMath::Lerp(AverageCost, Cycles, 0.1f) : Cycles;
+		}
+		else
+		{
+			ElementScore = Consideration->Evaluate(Context);
+		}
+
+		OutElements.AddScore(ElementScore, Consideration->GetDisplayName());
+		if (Combiner.Add(ElementScore))
+		{
+			OutElements.NumSkipped = NumToEvaluate - OrderIdx - 1;
+			OutElements.bStoppedEarly = Combiner.IsStoppedEarly();
+			break;
+		}
 	}
 
-	return 0.f;
+	return Combiner.GetResult();
 }
 
-float UUtilityAIAction::CombineScores(const TArray<float>& InScores, EUtilityAIScoreOperation Operation)
+bool UUtilityAIAction::HasDefaultConsiderations() const
 {
-	if (InScores.IsEmpty())
+	const FUtilityAIActionDefinition& ActionDefinition = GetDefinition();
+	if (this == ActionDefinition.DefaultAction)
 	{
-		return 0.f;
+		return true;
 	}
 
-	float Result = 0.f;
-	switch (Operation)
+	const TArray<const UUtilityAIConsideration*>& DefaultConsiderations = ActionDefinition.Considerations;
+	if (Considerations.Num() != DefaultConsiderations.Num())
 	{
-	case EUtilityAIScoreOperation::Multiply:
-		Result = 1.f;
-		for (const float ElementScore : InScores)
+		return false;
+	}
+	for (int32 Idx = 0; Idx < Considerations.Num(); ++Idx)
+	{
+		if (Considerations[Idx].Get() != DefaultConsiderations[Idx])
 		{
-			Result *= ElementScore;
+			return false;
 		}
-		break;
+	}
+	return true;
+}
 
-	case EUtilityAIScoreOperation::Max:
-		for (const float ElementScore : InScores)
-		{
-			Result = FMath::Max(Result, ElementScore);
-		}
-		break;
+float UUtilityAIAction::CalculateCustomScoreElements(FUtilityAIScoringElements& OutElements)
+{
+	if (GetDefinition().bHasBlueprintCalculateElementScores)
+	{
+		UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_BlueprintScore);
+
+		BlueprintElementScores.Reset();
+		EUtilityAIScoreOperation Operation;
+		CalculateElementScores_BP(BlueprintElementScores, Operation);
+
+		// element scores are calculated all at once by blueprints, use the Data scoring method to stop early
 
-	case EUtilityAIScoreOperation::Min:
-		Result = 1.f;
-		for (const float ElementScore : InScores)
+		// register the scores and desired operation
+		for (const FUtilityAIScore& Element : BlueprintElementScores)
 		{
-			Result = FMath::Min(Result, ElementScore);
+			OutElements.AddScore(Element);
 		}
-		break;
+		OutElements.Operation = Operation;
+
+		// calculate the result
+		return CombineScores(OutElements.Scores, OutElements.Operation);
+	}
+
+	if (GetDefinition().bHasBlueprintCalculateScore)
+	{
+		UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_BlueprintScore);
+		return CalculateScore_BP();
 	}
-	return Result;
+
+	return CalculateCustomScore();
+}
+
+float UUtilityAIAction::CalculateCustomScore()
+{
+	return 0.f;
+}
+
+float UUtilityAIAction::CombineScores(TConstArrayView<float> InScores, EUtilityAIScoreOperation Operation)
+{
+	return UUtilityAIStatics::CombineScores(InScores, Operation);
 }
 
 bool UUtilityAIAction::CanExecute() const
 {
-	return AreTagRequirementsMet() && Score > UE_SMALL_NUMBER;
+	return AreTagRequirementsMet() && GetScore() > UE_SMALL_NUMBER;
 }
 
 bool UUtilityAIAction::AreTagRequirementsMet() const
 {
-	if (RequireTags.IsEmpty() && IgnoreTags.IsEmpty() && TagQuery.IsEmpty())
+	const UUtilityAIComponent* AIComp = GetAIComponent();
+	if (AIComp && AIComp->Actions.IsValidIndex(ActionIndex))
 	{
-		// early out
-		return true;
+		// uses the compiled requirements and cached results stored by the component
+		return AIComp->CheckTagRequirements(ActionIndex);
 	}
 
-	const IGameplayTagAssetInterface* TagInterface = Cast<IGameplayTagAssetInterface>(GetAIController());
+	return !HasTagRequirements() || MatchesTagRequirements(GetAIController());
+}
+
+bool UUtilityAIAction::MatchesTagRequirements(const FGameplayTagContainer& Tags) const
+{
+	return Tags.HasAll(RequireTags) && !Tags.HasAny(IgnoreTags) && (TagQuery.IsEmpty() || TagQuery.Matches(Tags));
+}
+
+bool UUtilityAIAction::MatchesTagRequirements(const AActor* Actor) const
+{
+	const IGameplayTagAssetInterface* TagInterface = Cast<IGameplayTagAssetInterface>(Actor);
 	if (!TagInterface)
 	{
 		return false;
@@ -204,9 +332,9 @@ bool UUtilityAIAction::AreTagRequirementsMet() const
 
 	if (!TagQuery.IsEmpty())
 	{
-		FGameplayTagContainer ControllerOwnedTags;
-		TagInterface->GetOwnedGameplayTags(ControllerOwnedTags);
-		if (!TagQuery.Matches(ControllerOwnedTags))
+		FGameplayTagContainer OwnerTags;
+		TagInterface->GetOwnedGameplayTags(OwnerTags);
+		if (!TagQuery.Matches(OwnerTags))
 		{
 			return false;
 		}
@@ -220,7 +348,7 @@ void UUtilityAIAction::Initialize()
 	UE_LOG(LogUtilityAI, Verbose, TEXT("Initialize: %s"), *GetName());
 	bIsInitialized = true;
 
-	if (bHasBlueprintInitialize)
+	if (GetDefinition().bHasBlueprintInitialize)
 	{
 		Initialize_BP();
 	}
@@ -231,7 +359,7 @@ void UUtilityAIAction::Deinitialize()
 	UE_LOG(LogUtilityAI, Verbose, TEXT("Deinitialize: %s"), *GetName());
 	bIsInitialized = false;
 
-	if (bHasBlueprintDeinitialize)
+	if (GetDefinition().bHasBlueprintDeinitialize)
 	{
 		Deinitialize_BP();
 	}
@@ -239,14 +367,19 @@ void UUtilityAIAction::Deinitialize()
 
 void UUtilityAIAction::StartExecute()
 {
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_StartExecute);
+	UTILITYAI_TRACE_ACTION_SCOPE(*this);
+
 	UE_LOG(LogUtilityAI, Verbose, TEXT("Execute: %s"), *GetName());
-	bIsExecuting = true;
-	bIsAborting = false;
+	FUtilityAIActionState& State = GetMutableState();
+	State.bIsExecuting = true;
+	State.bIsAborting = false;
 
-	++ExecuteCount;
-	LastExecuteTime = GetWorld()->GetTimeSeconds();
+	++State.ExecuteCount;
+	State.LastExecuteTime = GetWorld()->GetTimeSeconds();
+	UpdateDeprecatedProperties();
 
-	if (bHasBlueprintExecute)
+	if (GetDefinition().bHasBlueprintExecute)
 	{
 		Execute_BP();
 	}
@@ -258,9 +391,12 @@ void UUtilityAIAction::StartExecute()
 
 void UUtilityAIAction::StartAbort()
 {
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_StartAbort);
+	UTILITYAI_TRACE_ACTION_SCOPE(*this);
+
 	UE_LOG(LogUtilityAI, Verbose, TEXT("Abort: %s"), *GetName());
-	bIsAborting = true;
-	if (bHasBlueprintAbort)
+	GetMutableState().bIsAborting = true;
+	if (GetDefinition().bHasBlueprintAbort)
 	{
 		Abort_BP();
 	}
@@ -282,29 +418,41 @@ void UUtilityAIAction::Abort()
 
 void UUtilityAIAction::Tick(float DeltaTime)
 {
+	if (GetDefinition().bHasBlueprintTick)
+	{
+		Tick_BP(DeltaTime);
+	}
 }
 
 void UUtilityAIAction::FreezeScore()
 {
-	bIsScoreFrozen = true;
+	GetMutableState().bIsScoreFrozen = true;
+	UpdateDeprecatedProperties();
 }
 
 void UUtilityAIAction::UnfreezeScore()
 {
-	bIsScoreFrozen = false;
+	GetMutableState().bIsScoreFrozen = false;
+	MarkScoreDirty();
+	UpdateDeprecatedProperties();
 }
 
 void UUtilityAIAction::FinishAction()
 {
 	UE_LOG(LogUtilityAI, Verbose, TEXT("Finished: %s"), *GetName());
-	bIsExecuting = false;
-	bIsAborting = false;
+	FUtilityAIActionState& State = GetMutableState();
+	State.bIsExecuting = false;
+	State.bIsAborting = false;
 
 	if (const UWorld* World = GetWorld())
 	{
-		LastFinishTime = GetWorld()->GetTimeSeconds();
+		State.LastFinishTime = World->GetTimeSeconds();
 	}
 
+	// the score may have been frozen while executing
+	MarkScoreDirty();
+	UpdateDeprecatedProperties();
+
 	OnFinished();
 }
 
@@ -312,7 +460,7 @@ void UUtilityAIAction::OnFinished()
 {
 	OnFinishedEvent.Broadcast();
 
-	if (bHasBlueprintOnFinished)
+	if (GetDefinition().bHasBlueprintOnFinished)
 	{
 		OnFinished_BP();
 	}
@@ -0,0 +1,149 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIActionDefinition.h"
+
+#include "UtilityAIAction.h"
+#include "UtilityAIConsideration.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/ObjectKey.h"
+
+
+namespace UtilityAIActionDefinitions
+{
+	/**
+	 * Definitions by class. Pointers are stable, since definitions are never removed while their class exists,
+	 * and are updated in place when refreshed.
+	 */
+	TMap<TObjectKey<UClass>, TUniquePtr<FUtilityAIActionDefinition>> Definitions;
+	FRWLock Lock;
+}
+
+
+FUtilityAIActionDefinition::FUtilityAIActionDefinition(const UClass* ActionClass)
+{
+	Update(ActionClass);
+}
+
+void FUtilityAIActionDefinition::Update(const UClass* ActionClass)
+{
+	TraceName = ActionClass->GetName();
+
+	bHasBlueprintInitialize = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Initialize_BP));
+	bHasBlueprintDeinitialize = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Deinitialize_BP));
+	bHasBlueprintCalculateElementScores = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, CalculateElementScores_BP));
+	bHasBlueprintCalculateScore = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, CalculateScore_BP));
+	bHasBlueprintExecute = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Execute_BP));
+	bHasBlueprintAbort = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Abort_BP));
+	bHasBlueprintOnFinished = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, OnFinished_BP));
+	bHasBlueprintTick = ActionClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UUtilityAIAction, Tick_BP));
+
+	// the base action's Tick does nothing but call Tick_BP
+	const UClass* NativeClass = ActionClass;
+	while (NativeClass && !NativeClass->HasAnyClassFlags(CLASS_Native))
+	{
+		NativeClass = NativeClass->GetSuperClass();
+	}
+	const bool bIsNativeSubclass = NativeClass != UUtilityAIAction::StaticClass();
+	bHasNativeTick = bIsNativeSubclass;
+
+	DefaultAction = ActionClass->GetDefaultObject<UUtilityAIAction>();
+	bIsCustomScoringThreadSafe = DefaultAction && DefaultAction->bIsCustomScoringThreadSafe &&
+		!bHasBlueprintCalculateElementScores && !bHasBlueprintCalculateScore;
+
+	// native overrides can't be detected, so native subclasses must declare that they don't change scoring
+	bCanScoreFromClassDefault = DefaultAction && DefaultAction->ScoringMethod == EUtilityAIScoringMethod::Data &&
+		(!bIsNativeSubclass || DefaultAction->bCanScoreFromClassDefault) &&
+		!bHasBlueprintInitialize && !bHasBlueprintDeinitialize &&
+		!bHasBlueprintCalculateElementScores && !bHasBlueprintCalculateScore;
+
+	Considerations.Reset();
+	bAreConsiderationsThreadSafe = true;
+	if (DefaultAction)
+	{
+		// the class default is scored from worker threads, so don't leave it to look up its definition lazily
+		DefaultAction->Definition = this;
+
+		for (const UUtilityAIConsideration* Consideration : DefaultAction->Considerations)
+		{
+			Considerations.Add(Consideration);
+			bAreConsiderationsThreadSafe &= !Consideration || Consideration->IsThreadSafe();
+		}
+	}
+
+	// measurements are for the previous considerations, start over
+	MeasuredConsiderationCosts.Reset();
+	SortConsiderationsByCost(false);
+}
+
+void FUtilityAIActionDefinition::SortConsiderationsByCost(bool bUseMeasuredCost) const
+{
+	NumCalculationsSinceSort = 0;
+
+	// keeps existing measurements, new entries start at 0 (not measured)
+	MeasuredConsiderationCosts.SetNumZeroed(Considerations.Num());
+
+	ConsiderationOrder.Reset();
+	bool bHasMeasuredAll = true;
+	for (int32 Idx = 0; Idx < Considerations.Num(); ++Idx)
+	{
+		if (Considerations[Idx])
+		{
+			ConsiderationOrder.Add(Idx);
+			bHasMeasuredAll &= MeasuredConsiderationCosts[Idx] > 0.f;
+		}
+	}
+
+	// measured and declared costs aren't comparable, only use measurements once every consideration has one
+	bUseMeasuredCost &= bHasMeasuredAll;
+	ConsiderationOrder.StableSort([this, bUseMeasuredCost](int32 A, int32 B)
+	{
+		if (bUseMeasuredCost)
+		{
+			return MeasuredConsiderationCosts[A] < MeasuredConsiderationCosts[B];
+		}
+		return Considerations[A]->Cost < Considerations[B]->Cost;
+	});
+}
+
+const FUtilityAIActionDefinition& FUtilityAIActionDefinition::Get(const UClass* ActionClass)
+{
+	using namespace UtilityAIActionDefinitions;
+	check(ActionClass);
+
+	const TObjectKey<UClass> Key(ActionClass);
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const TUniquePtr<FUtilityAIActionDefinition>* Definition = Definitions.Find(Key))
+		{
+			return **Definition;
+		}
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	TUniquePtr<FUtilityAIActionDefinition>& Definition = Definitions.FindOrAdd(Key);
+	if (!Definition)
+	{
+		Definition = TUniquePtr<FUtilityAIActionDefinition>(new FUtilityAIActionDefinition(ActionClass));
+	}
+	return *Definition;
+}
+
+void FUtilityAIActionDefinition::RefreshAll()
+{
+	using namespace UtilityAIActionDefinitions;
+
+	FWriteScopeLock WriteLock(Lock);
+	for (auto It = Definitions.CreateIterator(); It; ++It)
+	{
+		if (const UClass* ActionClass = It.Key().ResolveObjectPtr())
+		{
+			It.Value()->Update(ActionClass);
+		}
+		else
+		{
+			// the class and all of its instances are gone
+			It.RemoveCurrent();
+		}
+	}
+}
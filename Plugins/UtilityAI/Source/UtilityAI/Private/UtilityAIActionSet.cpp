@@ -4,6 +4,8 @@
 #include "UtilityAIActionSet.h"
 
 #include "UtilityAIAction.h"
+#include "UtilityAITypes.h"
+#include "UObject/ObjectSaveContext.h"
 
 
 void UUtilityAIActionSet::SortByWeight()
@@ -24,6 +26,112 @@ void UUtilityAIActionSet::SortByWeight()
 	});
 }
 
+bool UUtilityAIActionSet::CanUseCompiledTags() const
+{
+#if WITH_EDITOR
+	// action defaults can change without resaving the set, only cooked data is known to be up to date
+	return false;
+#else
+	return bHasCompiledTags;
+#endif
+}
+
+void UUtilityAIActionSet::Compile()
+{
+	CompiledActions.Reset(Actions.Num());
+	CompiledTags.Reset();
+	CompiledDependencyTags.Reset();
+	bHasCompiledTags = true;
+	bHasTagQueries = false;
+
+	const auto CompileTags = [this](const FGameplayTagContainer& Tags, TArray<uint8>& OutIndices)
+	{
+		for (const FGameplayTag& Tag : Tags)
+		{
+			const int32 Index = CompiledTags.AddUnique(Tag);
+			if (Index >= FUtilityAITagBits::NumBits)
+			{
+				bHasCompiledTags = false;
+				return;
+			}
+			OutIndices.Add(static_cast<uint8>(Index));
+		}
+	};
+
+	for (const auto& Elem : Actions)
+	{
+		if (!Elem.Key)
+		{
+			continue;
+		}
+
+		FUtilityAICompiledAction& CompiledAction = CompiledActions.AddDefaulted_GetRef();
+		CompiledAction.ActionClass = Elem.Key;
+		CompiledAction.ScoreWeight = Elem.Value;
+
+		const UUtilityAIAction* DefaultAction = Elem.Key->GetDefaultObject<UUtilityAIAction>();
+		if (!DefaultAction || DefaultAction->HasAnyFlags(RF_NeedLoad | RF_NeedPostLoad))
+		{
+			// can happen while loading, assume the action depends on everything
+			bHasCompiledTags = false;
+			bHasTagQueries = true;
+			continue;
+		}
+
+		CompileTags(DefaultAction->RequireTags, CompiledAction.RequireTagIndices);
+		CompileTags(DefaultAction->IgnoreTags, CompiledAction.IgnoreTagIndices);
+
+		CompiledDependencyTags.AppendTags(DefaultAction->RequireTags);
+		CompiledDependencyTags.AppendTags(DefaultAction->IgnoreTags);
+		CompiledDependencyTags.AppendTags(DefaultAction->DependencyTags);
+		bHasTagQueries |= !DefaultAction->TagQuery.IsEmpty();
+	}
+
+	// keep the map order, since exhaustive selection breaks ties by the order actions were added
+}
+
+bool UUtilityAIActionSet::AreCompiledActionsUpToDate() const
+{
+	// Actions can be edited from blueprints, so compare every entry, not just the count
+	int32 CompiledIdx = 0;
+	for (const auto& Elem : Actions)
+	{
+		if (!Elem.Key)
+		{
+			// null entries are skipped when compiling
+			continue;
+		}
+		if (!CompiledActions.IsValidIndex(CompiledIdx))
+		{
+			return false;
+		}
+
+		const FUtilityAICompiledAction& CompiledAction = CompiledActions[CompiledIdx++];
+		if (CompiledAction.ActionClass != Elem.Key || CompiledAction.ScoreWeight != Elem.Value)
+		{
+			return false;
+		}
+	}
+	return CompiledIdx == CompiledActions.Num();
+}
+
+void UUtilityAIActionSet::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITOR
+	// cooked sets are compiled when saved, but uncooked sets may be out of date
+	Compile();
+#endif
+}
+
+void UUtilityAIActionSet::PreSave(FObjectPreSaveContext SaveContext)
+{
+	Super::PreSave(SaveContext);
+
+	Compile();
+}
+
 #if WITH_EDITOR
 void UUtilityAIActionSet::PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent)
 {
@@ -47,5 +155,7 @@ void UUtilityAIActionSet::PostEditChangeProperty(struct FPropertyChangedEvent& P
 	}
 
 	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	Compile();
 }
 #endif
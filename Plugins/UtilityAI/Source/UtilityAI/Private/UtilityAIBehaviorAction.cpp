@@ -4,6 +4,9 @@
 #include "UtilityAIBehaviorAction.h"
 
 #include "AIController.h"
+#include "UtilityAIActionDefinition.h"
+#include "UtilityAIBehaviorTreeComponent.h"
+#include "UtilityAIComponent.h"
 #include "BehaviorTree/BehaviorTree.h"
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
@@ -19,14 +22,19 @@ UUtilityAIBehaviorAction::UUtilityAIBehaviorAction(const FObjectInitializer& Obj
 
 UBlackboardData* UUtilityAIBehaviorAction::GetBlackboardAsset() const
 {
-	return DefaultBehaviorAsset ? DefaultBehaviorAsset->GetBlackboardAsset() : nullptr;
+	// the persistent behavior owns the blackboard when set
+	const UBehaviorTree* BehaviorAsset = PersistentBehaviorAsset ? PersistentBehaviorAsset.Get() : DefaultBehaviorAsset.Get();
+	return BehaviorAsset ? BehaviorAsset->GetBlackboardAsset() : nullptr;
 }
 
 void UUtilityAIBehaviorAction::InitBlackboardKeys()
 {
+	// always resolve again, the blackboard asset may have been edited
+	UtilityActionKeyBlackboard.Reset();
+
 	if (const UBlackboardData* BBData = GetBlackboardAsset())
 	{
-		UtilityActionKey.ResolveSelectedKey(*BBData);
+		ResolveUtilityActionKey(*BBData);
 	}
 	else
 	{
@@ -34,6 +42,21 @@ void UUtilityAIBehaviorAction::InitBlackboardKeys()
 	}
 }
 
+void UUtilityAIBehaviorAction::ResolveUtilityActionKey(const UBlackboardData& BlackboardAsset)
+{
+	// key ids don't change for the lifetime of a blackboard asset
+	if (UtilityActionKeyBlackboard.Get() != &BlackboardAsset)
+	{
+		UtilityActionKey.ResolveSelectedKey(BlackboardAsset);
+		UtilityActionKeyBlackboard = &BlackboardAsset;
+	}
+}
+
+bool UUtilityAIBehaviorAction::UsesPersistentBehavior() const
+{
+	return PersistentBehaviorAsset && BehaviorInjectTag.IsValid();
+}
+
 bool UUtilityAIBehaviorAction::RunBehaviorTree(UBehaviorTree* BehaviorTree, bool bSingleRun)
 {
 	// TODO (bsayre): Weird having so much authority over the AI controller here, maybe move to cleaner statics?
@@ -44,14 +67,23 @@ bool UUtilityAIBehaviorAction::RunBehaviorTree(UBehaviorTree* BehaviorTree, bool
 		return false;
 	}
 
+	// when using a persistent behavior, it owns the blackboard and keeps running, and the behavior is injected into it
+	const bool bUsePersistentBehavior = UsesPersistentBehavior();
+	UBehaviorTree* RootTree = bUsePersistentBehavior ? PersistentBehaviorAsset.Get() : BehaviorTree;
+
+	// the brain component is shared by all behavior actions of the controller
+	UnbindBehaviorTreeEvents();
+	BTComp = UUtilityAIBehaviorTreeComponent::FindOrCreate(*AIController);
+	check(BTComp.IsValid());
+
 	bool bSuccess = true;
 
 	// get or create blackboard, don't change if existing blackboard is compatible with bt asset
 	UBlackboardComponent* BlackboardComp = AIController->GetBlackboardComponent();
-	if (BehaviorTree->BlackboardAsset &&
-		(BlackboardComp == nullptr || !BlackboardComp->IsCompatibleWith(BehaviorTree->BlackboardAsset)))
+	if (RootTree->BlackboardAsset &&
+		(BlackboardComp == nullptr || !BTComp->IsBlackboardCompatible(*BlackboardComp, RootTree->BlackboardAsset)))
 	{
-		bSuccess = AIController->UseBlackboard(BehaviorTree->BlackboardAsset, BlackboardComp);
+		bSuccess = AIController->UseBlackboard(RootTree->BlackboardAsset, BlackboardComp);
 	}
 
 	if (bSuccess)
@@ -59,29 +91,37 @@ bool UUtilityAIBehaviorAction::RunBehaviorTree(UBehaviorTree* BehaviorTree, bool
 		// set initial blackboard values
 		if (BlackboardComp)
 		{
-			if (BehaviorTree->BlackboardAsset)
+			if (RootTree->BlackboardAsset)
 			{
-				UtilityActionKey.ResolveSelectedKey(*BehaviorTree->BlackboardAsset);
+				ResolveUtilityActionKey(*RootTree->BlackboardAsset);
 			}
 
 			// store a reference to this utility action
 			BlackboardComp->SetValue<UBlackboardKeyType_Object>(UtilityActionKey.GetSelectedKeyID(), this);
 		}
 
-		BTComp = Cast<UBehaviorTreeComponent>(AIController->GetBrainComponent());
-		if (!BTComp.IsValid())
-		{
-			BTComp = NewObject<UBehaviorTreeComponent>(this, TEXT("BTComponent"));
-			BTComp->RegisterComponent();
-		}
-		check(BTComp.IsValid());
-
-		// assign newly created brain component
-		AIController->BrainComponent = BTComp.Get();
-
-		BTComp->StartTree(*BehaviorTree, bSingleRun ? EBTExecutionMode::SingleRun : EBTExecutionMode::Looped);
+		// mark as running first, in case the tree finishes immediately
 		CurrentBehavior = BehaviorTree;
+		CurrentRootBehavior = RootTree;
 		bIsBehaviorRunning = true;
+		bIsSingleRunBehavior = bSingleRun;
+		BTComp->OnTreeStopped.AddUObject(this, &UUtilityAIBehaviorAction::OnBehaviorTreeStopped);
+
+		if (bUsePersistentBehavior)
+		{
+			BTComp->OnInjectedBehaviorFinished.AddUObject(this, &UUtilityAIBehaviorAction::OnInjectedBehaviorFinished);
+
+			// the persistent behavior always loops, only the injected behavior is run once
+			if (!BTComp->IsRunning() || BTComp->GetRootTree() != RootTree)
+			{
+				BTComp->StartTree(*RootTree, EBTExecutionMode::Looped);
+			}
+			BTComp->InjectBehavior(BehaviorInjectTag, BehaviorTree);
+		}
+		else
+		{
+			BTComp->StartTree(*BehaviorTree, bSingleRun ? EBTExecutionMode::SingleRun : EBTExecutionMode::Looped);
+		}
 	}
 
 	return bSuccess;
@@ -89,15 +129,30 @@ bool UUtilityAIBehaviorAction::RunBehaviorTree(UBehaviorTree* BehaviorTree, bool
 
 bool UUtilityAIBehaviorAction::StopBehaviorTree(UBehaviorTree* BehaviorTree)
 {
+	if (bIsBehaviorRunning && UsesPersistentBehavior() && BehaviorTree && BehaviorTree == CurrentBehavior.Get())
+	{
+		// clear the injected behavior, but leave the persistent behavior running
+		if (BTComp.IsValid() && BTComp->GetRootTree() == CurrentRootBehavior.Get())
+		{
+			UnbindBehaviorTreeEvents();
+			bIsBehaviorRunning = false;
+
+			// when the next action replaces the behavior right away, let it restart the tree only once
+			BTComp->InjectBehavior(BehaviorInjectTag, nullptr, !IsNextActionInjectingBehavior());
+			return true;
+		}
+	}
+
 	if (const AAIController* AIController = GetAIController())
 	{
 		if (UBehaviorTreeComponent* BehaviorComp = Cast<UBehaviorTreeComponent>(AIController->GetBrainComponent()))
 		{
 			if (BehaviorComp->GetRootTree() == BehaviorTree)
 			{
-				BehaviorComp->StopTree(EBTStopMode::Safe);
 				// intentionally clear running flag, but leave CurrentBehavior in case someone wants it
+				UnbindBehaviorTreeEvents();
 				bIsBehaviorRunning = false;
+				BehaviorComp->StopTree(EBTStopMode::Safe);
 				return true;
 			}
 		}
@@ -105,6 +160,20 @@ bool UUtilityAIBehaviorAction::StopBehaviorTree(UBehaviorTree* BehaviorTree)
 	return false;
 }
 
+bool UUtilityAIBehaviorAction::IsNextActionInjectingBehavior() const
+{
+	const UUtilityAIComponent* AIComp = GetAIComponent();
+	const UUtilityAIBehaviorAction* NextAction = AIComp ? Cast<UUtilityAIBehaviorAction>(AIComp->GetNextAction()) : nullptr;
+	if (!NextAction || !NextAction->UsesPersistentBehavior() || !NextAction->DefaultBehaviorAsset)
+	{
+		return false;
+	}
+
+	// only the default Execute is known to run the default behavior
+	return NextAction->PersistentBehaviorAsset == PersistentBehaviorAsset && NextAction->BehaviorInjectTag == BehaviorInjectTag &&
+		!NextAction->GetDefinition().bHasBlueprintExecute;
+}
+
 bool UUtilityAIBehaviorAction::RunDefaultBehaviorTree()
 {
 	return RunBehaviorTree(DefaultBehaviorAsset, bSingleRunBehavior);
@@ -125,6 +194,13 @@ void UUtilityAIBehaviorAction::Initialize()
 	InitBlackboardKeys();
 }
 
+void UUtilityAIBehaviorAction::Deinitialize()
+{
+	UnbindBehaviorTreeEvents();
+
+	Super::Deinitialize();
+}
+
 void UUtilityAIBehaviorAction::Execute()
 {
 	RunDefaultBehaviorTree();
@@ -140,17 +216,52 @@ void UUtilityAIBehaviorAction::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	// poll to see if the behavior has stopped
-	// TODO (bsayre): add events to behavior tree component that we can bind to instead of polling
-	if (bIsBehaviorRunning && CurrentBehavior.IsValid() && BTComp.IsValid())
+	// StopTree and StartTree aren't virtual, so trees stopped or replaced by calling them directly aren't broadcast.
+	// wait for pending aborts, the tree being started may not be the root yet
+	if (bIsBehaviorRunning && BTComp.IsValid() && !BTComp->IsAbortPending() &&
+		(!BTComp->IsRunning() || BTComp->GetRootTree() != CurrentRootBehavior.Get()))
 	{
-		if (!BTComp->IsRunning() || BTComp->GetRootTree() != CurrentBehavior.Get())
-		{
-			// behavior is finished, notify the action
-			// intentionally clear running flag, but leave CurrentBehavior in case someone wants it
-			bIsBehaviorRunning = false;
-			OnBehaviorTreeFinished();
-		}
+		OnBehaviorTreeStopped(BTComp.Get(), CurrentRootBehavior.Get());
+	}
+}
+
+void UUtilityAIBehaviorAction::OnBehaviorTreeStopped(UUtilityAIBehaviorTreeComponent* InBTComp, UBehaviorTree* BehaviorTree)
+{
+	if (!bIsBehaviorRunning || BehaviorTree != CurrentRootBehavior.Get())
+	{
+		return;
+	}
+
+	// behavior is finished, notify the action
+	// intentionally clear running flag, but leave CurrentBehavior in case someone wants it
+	UnbindBehaviorTreeEvents();
+	bIsBehaviorRunning = false;
+	OnBehaviorTreeFinished();
+}
+
+void UUtilityAIBehaviorAction::OnInjectedBehaviorFinished(UUtilityAIBehaviorTreeComponent* InBTComp, FGameplayTag InjectTag, UBehaviorTree* BehaviorTree)
+{
+	// looped behaviors are rerun by the persistent behavior until the action stops them
+	if (!bIsBehaviorRunning || !bIsSingleRunBehavior || InjectTag != BehaviorInjectTag || BehaviorTree != CurrentBehavior.Get())
+	{
+		return;
+	}
+
+	UnbindBehaviorTreeEvents();
+	bIsBehaviorRunning = false;
+
+	// don't run the behavior again, but let the persistent behavior continue from the finished node
+	InBTComp->InjectBehavior(InjectTag, nullptr, false);
+
+	OnBehaviorTreeFinished();
+}
+
+void UUtilityAIBehaviorAction::UnbindBehaviorTreeEvents()
+{
+	if (BTComp.IsValid())
+	{
+		BTComp->OnTreeStopped.RemoveAll(this);
+		BTComp->OnInjectedBehaviorFinished.RemoveAll(this);
 	}
 }
 
@@ -160,7 +271,8 @@ void UUtilityAIBehaviorAction::PostEditChangeProperty(FPropertyChangedEvent& Pro
 	Super::PostEditChangeProperty(PropertyChangedEvent);
 
 	const FName PropertyName = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty->GetFName() : NAME_None;
-	if (PropertyName == GET_MEMBER_NAME_CHECKED(UUtilityAIBehaviorAction, DefaultBehaviorAsset))
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UUtilityAIBehaviorAction, DefaultBehaviorAsset) ||
+		PropertyName == GET_MEMBER_NAME_CHECKED(UUtilityAIBehaviorAction, PersistentBehaviorAsset))
 	{
 		InitBlackboardKeys();
 	}
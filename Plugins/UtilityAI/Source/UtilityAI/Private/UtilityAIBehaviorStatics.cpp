@@ -4,6 +4,7 @@
 #include "UtilityAIBehaviorStatics.h"
 
 #include "AIController.h"
+#include "UtilityAIComponent.h"
 #include "BehaviorTree/BehaviorTreeComponent.h"
 #include "BehaviorTree/BlackboardComponent.h"
 #include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
@@ -116,6 +117,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsObject(UUtilityAIAction* Act
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Object>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -124,6 +126,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsClass(UUtilityAIAction* Acti
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Class>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -132,6 +135,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsEnum(UUtilityAIAction* Actio
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Enum>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -140,6 +144,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsInt(UUtilityAIAction* Action
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Int>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -148,6 +153,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsFloat(UUtilityAIAction* Acti
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Float>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -156,6 +162,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsBool(UUtilityAIAction* Actio
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Bool>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -164,6 +171,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsString(UUtilityAIAction* Act
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_String>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -172,6 +180,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsName(UUtilityAIAction* Actio
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Name>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -182,6 +191,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsTag(UUtilityAIAction* Action
 	{
 		// TODO (bsayre): Add BlackboardKeyType_GameplayTag
 		BlackboardComp->SetValue<UBlackboardKeyType_Name>(Key.SelectedKeyName, Value.GetTagName());
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -190,6 +200,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsVector(UUtilityAIAction* Act
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Vector>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -199,6 +210,7 @@ void UUtilityAIBehaviorStatics::SetBlackboardValueAsRotator(UUtilityAIAction* Ac
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->SetValue<UBlackboardKeyType_Rotator>(Key.SelectedKeyName, Value);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
 	}
 }
 
@@ -207,5 +219,14 @@ void UUtilityAIBehaviorStatics::ClearBlackboardValue(UUtilityAIAction* ActionOwn
 	if (UBlackboardComponent* BlackboardComp = GetOwnersBlackboard(ActionOwner))
 	{
 		BlackboardComp->ClearValue(Key.SelectedKeyName);
+		NotifyBlackboardValueChanged(ActionOwner, Key);
+	}
+}
+
+void UUtilityAIBehaviorStatics::NotifyBlackboardValueChanged(UUtilityAIAction* ActionOwner, const FBlackboardKeySelector& Key)
+{
+	if (UUtilityAIComponent* AIComponent = ActionOwner ? ActionOwner->GetAIComponent() : nullptr)
+	{
+		AIComponent->NotifyBlackboardKeyChanged(Key.SelectedKeyName);
 	}
 }
@@ -0,0 +1,131 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIBehaviorTreeComponent.h"
+
+#include "AIController.h"
+#include "UtilityAIModule.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "BehaviorTree/BlackboardComponent.h"
+
+
+UUtilityAIBehaviorTreeComponent::UUtilityAIBehaviorTreeComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+UUtilityAIBehaviorTreeComponent* UUtilityAIBehaviorTreeComponent::FindOrCreate(AAIController& AIController)
+{
+	UBrainComponent* BrainComp = AIController.GetBrainComponent();
+	if (UUtilityAIBehaviorTreeComponent* BTComp = Cast<UUtilityAIBehaviorTreeComponent>(BrainComp))
+	{
+		return BTComp;
+	}
+
+	if (BrainComp)
+	{
+		UE_LOG(LogUtilityAI, Warning, TEXT("%s: Replacing brain component %s with a UtilityAIBehaviorTreeComponent, ")
+		       TEXT("use a UtilityAIBehaviorTreeComponent as the brain to avoid this."),
+		       *AIController.GetName(), *BrainComp->GetName());
+
+		// don't leave the old brain registered, it would still receive messages and ticks
+		BrainComp->StopLogic(TEXT("Replaced by UtilityAIBehaviorTreeComponent"));
+		BrainComp->DestroyComponent();
+	}
+
+	const FName Name = MakeUniqueObjectName(&AIController, StaticClass(), TEXT("UtilityAIBTComponent"));
+	UUtilityAIBehaviorTreeComponent* BTComp = NewObject<UUtilityAIBehaviorTreeComponent>(&AIController, Name);
+	BTComp->RegisterComponent();
+	AIController.BrainComponent = BTComp;
+	return BTComp;
+}
+
+void UUtilityAIBehaviorTreeComponent::InjectBehavior(FGameplayTag InjectTag, UBehaviorTree* BehaviorAsset, bool bUpdateRunningTree)
+{
+	InjectedBehaviors.Add(InjectTag, BehaviorAsset);
+
+	if (bUpdateRunningTree)
+	{
+		// updates matching nodes in the running tree, and restarts the tree if any were found
+		SetDynamicSubtree(InjectTag, BehaviorAsset);
+	}
+}
+
+bool UUtilityAIBehaviorTreeComponent::FindInjectedBehavior(FGameplayTag InjectTag, UBehaviorTree*& OutBehaviorAsset) const
+{
+	if (const TObjectPtr<UBehaviorTree>* BehaviorAsset = InjectedBehaviors.Find(InjectTag))
+	{
+		OutBehaviorAsset = *BehaviorAsset;
+		return true;
+	}
+	return false;
+}
+
+void UUtilityAIBehaviorTreeComponent::NotifyInjectedBehaviorFinished(FGameplayTag InjectTag, UBehaviorTree* BehaviorAsset)
+{
+	if (BehaviorAsset)
+	{
+		OnInjectedBehaviorFinished.Broadcast(this, InjectTag, BehaviorAsset);
+	}
+}
+
+bool UUtilityAIBehaviorTreeComponent::IsBlackboardCompatible(const UBlackboardComponent& BlackboardComp, const UBlackboardData* BlackboardAsset)
+{
+	const UBlackboardData* CurrentAsset = BlackboardComp.GetBlackboardAsset();
+	if (!CurrentAsset || !BlackboardAsset)
+	{
+		return BlackboardComp.IsCompatibleWith(BlackboardAsset);
+	}
+
+	const TPair<TObjectKey<UBlackboardData>, TObjectKey<UBlackboardData>> Key(CurrentAsset, BlackboardAsset);
+	if (const bool* bIsCompatible = BlackboardCompatibility.Find(Key))
+	{
+		return *bIsCompatible;
+	}
+
+	const bool bIsCompatible = BlackboardComp.IsCompatibleWith(BlackboardAsset);
+	BlackboardCompatibility.Add(Key, bIsCompatible);
+	return bIsCompatible;
+}
+
+void UUtilityAIBehaviorTreeComponent::StopLogic(const FString& Reason)
+{
+	UBehaviorTree* BehaviorTree = GetRootTree();
+	const bool bWasRunning = IsRunning();
+
+	Super::StopLogic(Reason);
+
+	BroadcastTreeStopped(BehaviorTree, bWasRunning);
+}
+
+void UUtilityAIBehaviorTreeComponent::Cleanup()
+{
+	UBehaviorTree* BehaviorTree = GetRootTree();
+	const bool bWasRunning = IsRunning();
+
+	Super::Cleanup();
+
+	BroadcastTreeStopped(BehaviorTree, bWasRunning);
+}
+
+void UUtilityAIBehaviorTreeComponent::OnTreeFinished()
+{
+	UBehaviorTree* BehaviorTree = GetRootTree();
+	const bool bWasRunning = IsRunning();
+
+	Super::OnTreeFinished();
+
+	// looped trees restart instead of stopping
+	if (!IsRunning() || GetRootTree() != BehaviorTree)
+	{
+		BroadcastTreeStopped(BehaviorTree, bWasRunning);
+	}
+}
+
+void UUtilityAIBehaviorTreeComponent::BroadcastTreeStopped(UBehaviorTree* BehaviorTree, bool bWasRunning)
+{
+	if (bWasRunning && BehaviorTree)
+	{
+		OnTreeStopped.Broadcast(this, BehaviorTree);
+	}
+}
@@ -5,8 +5,62 @@
 
 #include "AIController.h"
 #include "GameplayTagAssetInterface.h"
+#include "UtilityAIActionDefinition.h"
 #include "UtilityAIActionSet.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIDecisionRecorder.h"
 #include "UtilityAIModule.h"
+#include "UtilityAIScoringSnapshot.h"
+#include "UtilityAIStats.h"
+#include "UtilityAISubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Perception/AIPerceptionComponent.h"
+#include "UObject/UObjectIterator.h"
+
+
+/** Read for every action that's scored, so it's bound to a plain variable instead of a TAutoConsoleVariable. */
+static int32 DebugCalculateScores = 0;
+FAutoConsoleVariableRef CVarDebugCalculateScores(
+	TEXT("ai.Utility.DebugCalculateScores"),
+	DebugCalculateScores,
+	TEXT("Always calculate scores for debugging purposes, even for actions that cannot execute.\n")
+	TEXT("0: Disabled. 1: For all agents. 2: Only for agents being inspected by the gameplay debugger, or with bDebugCalculateScores set."));
+
+
+namespace UtilityAIComponent
+{
+	void DebugCalculateScoresFor(const TArray<FString>& Args)
+	{
+		int32 NumEnabled = 0;
+		for (TObjectIterator<UUtilityAIComponent> It; It; ++It)
+		{
+			if (It->IsTemplate())
+			{
+				continue;
+			}
+
+			const AAIController* AIController = It->GetAIController();
+			const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr;
+
+			bool bMatches = false;
+			for (const FString& Arg : Args)
+			{
+				bMatches |= GetNameSafe(It->GetOwner()).Contains(Arg) || (Pawn && Pawn->GetName().Contains(Arg));
+			}
+
+			It->bDebugCalculateScores = bMatches;
+			NumEnabled += bMatches ? 1 : 0;
+		}
+		UE_LOG(LogUtilityAI, Display, TEXT("Debug calculating scores for %d agents"), NumEnabled);
+	}
+
+	FAutoConsoleCommand DebugCalculateScoresForCommand(
+		TEXT("ai.Utility.DebugCalculateScoresFor"),
+		TEXT("Fully score actions for debugging only for agents whose AIController or pawn name contains any of the arguments, ")
+		TEXT("when ai.Utility.DebugCalculateScores is 2. Clears the set when called without arguments."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&DebugCalculateScoresFor));
+}
 
 
 UUtilityAIComponent::UUtilityAIComponent()
@@ -34,54 +88,170 @@ void UUtilityAIComponent::AddDefaultActions()
 
 void UUtilityAIComponent::AddAction_Implementation(TSubclassOf<UUtilityAIAction> ActionClass)
 {
-	CreateActionInstance(ActionClass);
+	CreateAction(ActionClass);
 }
 
 void UUtilityAIComponent::AddActionsFromSet_Implementation(const UUtilityAIActionSet* ActionSet)
 {
-	for (const auto& Elem : ActionSet->Actions)
+	if (!ActionSet)
+	{
+		return;
+	}
+
+	const TArray<FUtilityAICompiledAction>& CompiledActions = ActionSet->GetCompiledActions();
+	if (!ActionSet->AreCompiledActionsUpToDate())
+	{
+		// the set was changed at runtime and not recompiled
+		ReserveActions(ActionSet->Actions.Num());
+		for (const auto& Elem : ActionSet->Actions)
+		{
+			CreateAction(Elem.Key, Elem.Value);
+		}
+		return;
+	}
+
+	// map the set's tags to the tag table once, rather than compiling each action's tags
+	TArray<int32> CompiledTagIndices;
+	const bool bUseCompiledTags = ActionSet->CanUseCompiledTags() &&
+		CompileTagTable(ActionSet->GetCompiledTags(), CompiledTagIndices);
+	if (bUseCompiledTags)
+	{
+		ActionDependencyTags.AppendTags(ActionSet->GetCompiledDependencyTags());
+		bAnyActionDependsOnAllTags |= ActionSet->HasTagQueries();
+	}
+
+	ReserveActions(CompiledActions.Num());
+	for (const FUtilityAICompiledAction& CompiledAction : CompiledActions)
 	{
-		CreateActionInstance(Elem.Key, Elem.Value);
+		CreateAction(CompiledAction.ActionClass, CompiledAction.ScoreWeight,
+		             bUseCompiledTags ? &CompiledAction : nullptr, CompiledTagIndices);
 	}
 }
 
-void UUtilityAIComponent::DeinitializeActions()
+void UUtilityAIComponent::RemoveAction(TSubclassOf<UUtilityAIAction> ActionClass)
 {
-	for (UUtilityAIAction* Action : Actions)
+	if (const int32* ActionIdx = ActionIndicesByClass.Find(ActionClass.Get()))
 	{
-		Action->Deinitialize();
-		Action->ConditionalBeginDestroy();
+		DestroyAction(*ActionIdx);
 	}
-	Actions.Empty();
 }
 
-bool UUtilityAIComponent::HasAction(TSubclassOf<UUtilityAIAction> ActionClass) const
+void UUtilityAIComponent::RemoveActionsFromSet(const UUtilityAIActionSet* ActionSet)
 {
-	for (const UUtilityAIAction* Action : Actions)
+	if (!ActionSet)
 	{
-		if (Action && Action->GetClass() == ActionClass)
-		{
-			return true;
-		}
+		return;
 	}
-	return false;
+
+	for (const auto& Elem : ActionSet->Actions)
+	{
+		RemoveAction(Elem.Key);
+	}
+}
+
+void UUtilityAIComponent::ReserveActions(int32 NumNewActions)
+{
+	const int32 NumActions = Actions.Num() + NumNewActions;
+	Actions.Reserve(NumActions);
+	ActionStates.Reserve(NumActions);
+	ActionSlots.Reserve(NumActions);
+	ActionIndicesByClass.Reserve(NumActions);
 }
 
-UUtilityAIAction* UUtilityAIComponent::GetAction(TSubclassOf<UUtilityAIAction> ActionClass) const
+void UUtilityAIComponent::DeinitializeActions()
 {
+	CancelAsyncScoring();
+
+	// the current action's index won't be valid once the actions are re-added
+	AbortCurrentAction();
+	if (CurrentAction)
+	{
+		CurrentAction->OnFinishedEvent.RemoveAll(this);
+	}
+	CurrentAction = nullptr;
+	NextAction = nullptr;
+
 	for (UUtilityAIAction* Action : Actions)
 	{
-		if (Action && Action->GetClass() == ActionClass)
+		if (Action)
 		{
-			return Action;
+			Action->Deinitialize();
+			Action->ActionIndex = INDEX_NONE;
+			Action->ConditionalBeginDestroy();
 		}
 	}
-	return nullptr;
+	Actions.Empty();
+	ActionStates.Empty();
+	ActionSlots.Empty();
+	ActionIndicesByClass.Empty();
+	ActionDependencyTags.Reset();
+	bAnyActionDependsOnAllTags = false;
+	ActionsByWeight.Reset();
+	InterruptMatrix.Reset();
+}
+
+bool UUtilityAIComponent::HasAction(TSubclassOf<UUtilityAIAction> ActionClass) const
+{
+	return ActionIndicesByClass.Contains(ActionClass.Get());
+}
+
+UUtilityAIAction* UUtilityAIComponent::GetAction(TSubclassOf<UUtilityAIAction> ActionClass)
+{
+	const int32* ActionIdx = ActionIndicesByClass.Find(ActionClass.Get());
+	return ActionIdx ? GetOrCreateActionInstance(*ActionIdx) : nullptr;
+}
+
+const UClass* UUtilityAIComponent::GetActionClass(int32 ActionIdx) const
+{
+	return ActionSlots[ActionIdx].Definition->DefaultAction->GetClass();
+}
+
+const UUtilityAIAction& UUtilityAIComponent::GetActionOrDefault(int32 ActionIdx) const
+{
+	const UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? *Action : *ActionSlots[ActionIdx].Definition->DefaultAction;
+}
+
+UUtilityAIAction* UUtilityAIComponent::GetOrCreateActionInstance(int32 ActionIdx)
+{
+	if (ActionIdx == INDEX_NONE)
+	{
+		return nullptr;
+	}
+	UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action : CreateActionInstance(ActionIdx);
+}
+
+float UUtilityAIComponent::GetActionScoreWeight(int32 ActionIdx) const
+{
+	// instances can change their weight at runtime
+	const UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action->ScoreWeight : ActionSlots[ActionIdx].ScoreWeight;
+}
+
+const FUtilityAIScoringElements& UUtilityAIComponent::GetActionScoringElements(int32 ActionIdx) const
+{
+	const UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action->ScoringElements : ActionSlots[ActionIdx].ScoringElements;
+}
+
+FUtilityAIScoringElements& UUtilityAIComponent::GetMutableActionScoringElements(int32 ActionIdx)
+{
+	UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action->ScoringElements : ActionSlots[ActionIdx].ScoringElements;
 }
 
 bool UUtilityAIComponent::IsBusy() const
 {
-	if (const IGameplayTagAssetInterface* OwnerTagInterface = Cast<IGameplayTagAssetInterface>(GetOwner()))
+	if (bHasCompiledBusyTags && OwnerTagBitsFrame == GFrameCounter)
+	{
+		// owner tags were captured this frame
+		if (OwnerTagBits.HasAny(BusyTagBits))
+		{
+			return true;
+		}
+	}
+	else if (const IGameplayTagAssetInterface* OwnerTagInterface = Cast<IGameplayTagAssetInterface>(GetOwner()))
 	{
 		if (OwnerTagInterface->HasAnyMatchingGameplayTags(BusyTags))
 		{
@@ -95,8 +265,29 @@ bool UUtilityAIComponent::IsBusy() const
 	return false;
 }
 
+bool UUtilityAIComponent::IsInCombat() const
+{
+	if (const IGameplayTagAssetInterface* OwnerTagInterface = Cast<IGameplayTagAssetInterface>(GetOwner()))
+	{
+		return OwnerTagInterface->HasAnyMatchingGameplayTags(CombatTags);
+	}
+	return false;
+}
+
 void UUtilityAIComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+	BindPerceptionEvents(false);
+
+	if (UUtilityAISubsystem* Subsystem = GetUtilityAISubsystem())
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
+	if (FUtilityAIDecisionRecorder* Recorder = FUtilityAIDecisionRecorder::Get())
+	{
+		Recorder->RemoveAgent(*this);
+	}
+
 	DeinitializeActions();
 
 	Super::EndPlay(EndPlayReason);
@@ -106,122 +297,1043 @@ void UUtilityAIComponent::Activate(bool bReset)
 {
 	Super::Activate(bReset);
 
+	SelectionStats = FUtilityAISelectionStats();
+
+	RecompileTags();
 	AddDefaultActions();
+	BindPerceptionEvents(true);
+
+	if (bUseSubsystemTick)
+	{
+		if (UUtilityAISubsystem* Subsystem = GetUtilityAISubsystem())
+		{
+			SetComponentTickEnabled(false);
+			Subsystem->RegisterComponent(this);
+		}
+	}
 }
 
 void UUtilityAIComponent::Deactivate()
 {
+	BindPerceptionEvents(false);
+
+	if (UUtilityAISubsystem* Subsystem = GetUtilityAISubsystem())
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
 	DeinitializeActions();
 
 	Super::Deactivate();
 }
 
-UUtilityAIAction* UUtilityAIComponent::CreateActionInstance(TSubclassOf<UUtilityAIAction> ActionClass, float ScoreWeight)
+int32 UUtilityAIComponent::CreateAction(TSubclassOf<UUtilityAIAction> ActionClass, float ScoreWeight,
+                                       const FUtilityAICompiledAction* CompiledAction,
+                                       TConstArrayView<int32> CompiledTagIndices)
 {
 	if (!ActionClass || HasAction(ActionClass))
 	{
-		// action already instanced
-		return nullptr;
+		// action already added
+		return INDEX_NONE;
 	}
 
-	UUtilityAIAction* NewAction = NewObject<UUtilityAIAction>(this, ActionClass, NAME_None, RF_Transient);
-	if (NewAction)
+	// background scoring reads action states, which may be reallocated
+	CancelAsyncScoring();
+
+	const FUtilityAIActionDefinition& Definition = FUtilityAIActionDefinition::Get(ActionClass);
+	const UUtilityAIAction& DefaultAction = *Definition.DefaultAction;
+
+	const int32 ActionIdx = ActionSlots.AddDefaulted();
+	Actions.Add(nullptr);
+	ActionStates.AddDefaulted();
+	ActionIndicesByClass.Add(ActionClass.Get(), ActionIdx);
+	bAnyActionReadsScoringSnapshot |= DefaultAction.ReadsScoringSnapshot();
+
+	FUtilityAIActionSlot& Slot = ActionSlots[ActionIdx];
+	Slot.Definition = &Definition;
+	Slot.ScoreWeight = ScoreWeight >= 0.f ? ScoreWeight : DefaultAction.ScoreWeight;
+
+	if (CompiledAction)
 	{
-		if (ScoreWeight >= 0.f)
+		for (const uint8 TagIdx : CompiledAction->RequireTagIndices)
 		{
-			NewAction->ScoreWeight = ScoreWeight;
+			Slot.RequireTagBits.SetBit(CompiledTagIndices[TagIdx]);
 		}
+		for (const uint8 TagIdx : CompiledAction->IgnoreTagIndices)
+		{
+			Slot.IgnoreTagBits.SetBit(CompiledTagIndices[TagIdx]);
+		}
+		Slot.bHasCompiledTagRequirements = true;
+	}
+	else
+	{
+		CompileTagRequirements(ActionIdx);
+		AddActionTagDependencies(DefaultAction);
+	}
 
-		Actions.Add(NewAction);
-
-		NewAction->Initialize();
+	// other actions are scored from their class default until they're selected
+	if (!Definition.bCanScoreFromClassDefault)
+	{
+		CreateActionInstance(ActionIdx);
 	}
+	return ActionIdx;
+}
+
+UUtilityAIAction* UUtilityAIComponent::CreateActionInstance(int32 ActionIdx)
+{
+	check(ActionSlots.IsValidIndex(ActionIdx) && !Actions[ActionIdx]);
+
+	// background scoring reads the properties of the class default until the instance replaces it
+	AsyncScoringTask.Wait();
+
+	FUtilityAIActionSlot& Slot = ActionSlots[ActionIdx];
+	UUtilityAIAction* NewAction = NewObject<UUtilityAIAction>(this, Slot.Definition->DefaultAction->GetClass(), NAME_None, RF_Transient);
+	NewAction->Definition = Slot.Definition;
+	NewAction->ActionIndex = ActionIdx;
+	NewAction->ScoreWeight = Slot.ScoreWeight;
+	NewAction->ScoringElements = MoveTemp(Slot.ScoringElements);
+	Slot.ScoringElements.Reset();
+	Actions[ActionIdx] = NewAction;
+
+	NewAction->UpdateDeprecatedProperties();
+	NewAction->Initialize();
 	return NewAction;
 }
 
-UUtilityAIAction* UUtilityAIComponent::SelectAction()
+void UUtilityAIComponent::DestroyAction(int32 ActionIdx)
 {
-	UUtilityAIAction* BestAction = nullptr;
+	check(ActionSlots.IsValidIndex(ActionIdx));
 
-	for (UUtilityAIAction* Action : Actions)
+	CancelAsyncScoring();
+
+	UUtilityAIAction* Action = Actions[ActionIdx];
+	if (Action && Action == CurrentAction)
+	{
+		AbortCurrentAction();
+		CurrentAction = nullptr;
+	}
+
+	if (Action)
 	{
-		Action->UpdateScore();
+		Action->Deinitialize();
+	}
 
-		if (!Action->CanExecute())
+	// swap the last action into the removed slot, keeping its state with it
+	ActionIndicesByClass.Remove(GetActionClass(ActionIdx));
+	Actions.RemoveAtSwap(ActionIdx, 1, EAllowShrinking::No);
+	ActionStates.RemoveAtSwap(ActionIdx, 1, EAllowShrinking::No);
+	ActionSlots.RemoveAtSwap(ActionIdx, 1, EAllowShrinking::No);
+	if (ActionSlots.IsValidIndex(ActionIdx))
+	{
+		if (UUtilityAIAction* MovedAction = Actions[ActionIdx])
 		{
-			continue;
+			MovedAction->ActionIndex = ActionIdx;
 		}
+		ActionIndicesByClass.Add(GetActionClass(ActionIdx), ActionIdx);
+	}
+
+	if (Action)
+	{
+		Action->ActionIndex = INDEX_NONE;
+		Action->ConditionalBeginDestroy();
+	}
+
+	// indices have changed, rebuild on next use
+	ActionsByWeight.Reset();
+	InterruptMatrix.Reset();
+}
+
+TSharedRef<FUtilityAIScoringSnapshot> UUtilityAIComponent::CreateScoringSnapshot() const
+{
+	return MakeShared<FUtilityAIScoringSnapshot>();
+}
+
+void UUtilityAIComponent::CaptureScoringSnapshot(FUtilityAIScoringSnapshot& Snapshot) const
+{
+	const UWorld* World = GetWorld();
+	Snapshot.WorldTime = World ? World->GetTimeSeconds() : 0.0;
+
+	Snapshot.OwnerTags.Reset();
+	if (const IGameplayTagAssetInterface* OwnerTagInterface = Cast<IGameplayTagAssetInterface>(GetOwner()))
+	{
+		OwnerTagInterface->GetOwnedGameplayTags(Snapshot.OwnerTags);
+	}
+
+	const AAIController* AIController = GetAIController();
+	const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr;
+	Snapshot.bHasPawn = Pawn != nullptr;
+	if (Pawn)
+	{
+		Snapshot.PawnLocation = Pawn->GetActorLocation();
+		Snapshot.PawnRotation = Pawn->GetActorRotation();
+		Snapshot.PawnVelocity = Pawn->GetVelocity();
+	}
+}
+
+bool UUtilityAIComponent::NeedsScoringSnapshot() const
+{
+	// the recorder stores the tags from the snapshot
+	return bAnyActionReadsScoringSnapshot || FUtilityAIDecisionRecorder::Get() != nullptr;
+}
+
+void UUtilityAIComponent::UpdateScoringSnapshot()
+{
+	if (!ScoringSnapshot)
+	{
+		ScoringSnapshot = CreateScoringSnapshot();
+	}
+	CaptureScoringSnapshot(*ScoringSnapshot);
+	OwnerTagBitsFrame = GFrameCounter;
 
-		if (!BestAction)
+	UpdateOwnerTagDependencies();
+}
+
+void UUtilityAIComponent::UpdateOwnerTagDependencies()
+{
+	const FGameplayTagContainer& OwnerTags = ScoringSnapshot->OwnerTags;
+	if (OwnerTags == LastOwnerTags)
+	{
+		return;
+	}
+
+	ChangedOwnerTags.Reset();
+	for (const FGameplayTag& Tag : OwnerTags)
+	{
+		if (!LastOwnerTags.HasTagExact(Tag))
 		{
-			BestAction = Action;
-			continue;
+			ChangedOwnerTags.AddTagFast(Tag);
 		}
-
-		const float ScoreToBeat = BestAction->GetScore() + (BestAction->IsExecuting() ? ScoreHysteresisThreshold : 0.f);
-		if (Action->GetScore() > ScoreToBeat)
+	}
+	for (const FGameplayTag& Tag : LastOwnerTags)
+	{
+		if (!OwnerTags.HasTagExact(Tag))
 		{
-			BestAction = Action;
+			ChangedOwnerTags.AddTagFast(Tag);
 		}
 	}
+	LastOwnerTags = OwnerTags;
+	++OwnerTagsSerial;
+	UpdateOwnerTagBits();
+
+	if (!bAnyActionDependsOnAllTags && !ChangedOwnerTags.HasAny(ActionDependencyTags))
+	{
+		return;
+	}
 
-	return BestAction;
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+		if (Action.bScoreOnlyWhenDirty && Action.DependsOnTags(ChangedOwnerTags))
+		{
+			ActionStates[ActionIdx].bIsScoreDirty = true;
+		}
+	}
 }
 
-bool UUtilityAIComponent::CanActivateAction(UUtilityAIAction* NewAction)
+void UUtilityAIComponent::RecompileTags()
 {
-	// when busy, don't allow starting a new action, even if no action is active
-	return !IsBusy() || (CurrentAction && CurrentAction->OwnedTags.HasAny(NewAction->InterruptActionsWithTags));
+	TagTable.Reset();
+	bHasCompiledBusyTags = CompileTags(BusyTags, BusyTagBits);
+
+	// actions that were added before activating were compiled against the old table
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		CompileTagRequirements(ActionIdx);
+		AddActionTagDependencies(GetActionOrDefault(ActionIdx));
+	}
+
+	UpdateOwnerTagBits();
+	MarkAllScoresDirty();
 }
 
-void UUtilityAIComponent::AbortCurrentAction()
+bool UUtilityAIComponent::CompileTags(const FGameplayTagContainer& Tags, FUtilityAITagBits& OutBits)
 {
-	if (CurrentAction && CurrentAction->IsExecuting())
+	OutBits.Reset();
+	for (const FGameplayTag& Tag : Tags)
 	{
-		CurrentAction->OnFinishedEvent.RemoveAll(this);
-		CurrentAction->StartAbort();
+		const int32 Index = TagTable.AddUnique(Tag);
+		if (Index >= FUtilityAITagBits::NumBits)
+		{
+			TagTable.Pop(EAllowShrinking::No);
+			return false;
+		}
+		OutBits.SetBit(Index);
 	}
+	return true;
 }
 
-void UUtilityAIComponent::OnCurrentActionFinished()
+bool UUtilityAIComponent::CompileTagTable(TConstArrayView<FGameplayTag> Tags, TArray<int32>& OutIndices)
 {
-	// clear the current action allowing it to re-execute if necessary
-	if (CurrentAction)
+	const int32 NumTags = TagTable.Num();
+
+	OutIndices.Reset(Tags.Num());
+	for (const FGameplayTag& Tag : Tags)
 	{
-		CurrentAction->OnFinishedEvent.RemoveAll(this);
+		const int32 Index = TagTable.AddUnique(Tag);
+		if (Index >= FUtilityAITagBits::NumBits)
+		{
+			TagTable.SetNum(NumTags, EAllowShrinking::No);
+			return false;
+		}
+		OutIndices.Add(Index);
 	}
-	CurrentAction = nullptr;
+
+	if (TagTable.Num() != NumTags && ScoringSnapshot)
+	{
+		// new tags need their bits set
+		UpdateOwnerTagBits();
+	}
+	return true;
 }
 
+void UUtilityAIComponent::AddActionTagDependencies(const UUtilityAIAction& Action)
+{
+	ActionDependencyTags.AppendTags(Action.RequireTags);
+	ActionDependencyTags.AppendTags(Action.IgnoreTags);
+	ActionDependencyTags.AppendTags(Action.DependencyTags);
+	bAnyActionDependsOnAllTags |= !Action.TagQuery.IsEmpty();
+}
 
-void UUtilityAIComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UUtilityAIComponent::CompileTagRequirements(int32 ActionIdx)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	const int32 NumTags = TagTable.Num();
 
-	if (!IsActive())
+	const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+	FUtilityAIActionSlot& Slot = ActionSlots[ActionIdx];
+	Slot.bHasCompiledTagRequirements = CompileTags(Action.RequireTags, Slot.RequireTagBits) &&
+		CompileTags(Action.IgnoreTags, Slot.IgnoreTagBits);
+
+	if (!Slot.bHasCompiledTagRequirements)
 	{
-		return;
+		UE_LOG(LogUtilityAI, Verbose, TEXT("Too many unique tags to compile tag requirements for %s, using the slower path"),
+		       *GetActionClass(ActionIdx)->GetName());
 	}
 
-	UUtilityAIAction* BestAction = SelectAction();
+	if (TagTable.Num() != NumTags && ScoringSnapshot)
+	{
+		// new tags need their bits set
+		UpdateOwnerTagBits();
+	}
+}
 
-	if (BestAction && BestAction != CurrentAction && CanActivateAction(BestAction))
+bool UUtilityAIComponent::CheckTagRequirements(int32 ActionIdx) const
+{
+	const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+	if (!Action.HasTagRequirements())
 	{
-		AbortCurrentAction();
+		// early out
+		return true;
+	}
 
-		CurrentAction = BestAction;
+	// use the tags already fetched for this decision, instead of copying them again,
+	// but not from an earlier frame since the tags may have changed since then
+	if (!IsScoringSnapshotCurrent())
+	{
+		return Action.MatchesTagRequirements(GetAIController());
+	}
 
-		if (CurrentAction)
+	const FUtilityAIActionSlot& Slot = ActionSlots[ActionIdx];
+	if (Slot.bHasCompiledTagRequirements && Action.TagQuery.IsEmpty())
+	{
+		return OwnerTagBits.HasAll(Slot.RequireTagBits) && !OwnerTagBits.HasAny(Slot.IgnoreTagBits);
+	}
+
+	// tag queries can't be compiled, so cache the result instead
+	if (Slot.TagRequirementsFrame != GFrameCounter || Slot.TagRequirementsSerial != OwnerTagsSerial)
+	{
+		Slot.bCachedTagRequirementsMet = Action.MatchesTagRequirements(ScoringSnapshot->OwnerTags);
+		Slot.TagRequirementsFrame = GFrameCounter;
+		Slot.TagRequirementsSerial = OwnerTagsSerial;
+	}
+	return Slot.bCachedTagRequirementsMet;
+}
+
+bool UUtilityAIComponent::AreActionTagRequirementsMet(int32 ActionIdx) const
+{
+	// instances may override AreTagRequirementsMet
+	const UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action->AreTagRequirementsMet() : CheckTagRequirements(ActionIdx);
+}
+
+void UUtilityAIComponent::UpdateOwnerTagBits()
+{
+	OwnerTagBits.Reset();
+	if (!ScoringSnapshot)
+	{
+		return;
+	}
+
+	// parent tags are matched here once, instead of every time requirements are checked
+	for (int32 Idx = 0; Idx < TagTable.Num(); ++Idx)
+	{
+		if (ScoringSnapshot->OwnerTags.HasTag(TagTable[Idx]))
 		{
-			CurrentAction->OnFinishedEvent.AddUObject(this, &UUtilityAIComponent::OnCurrentActionFinished);
-			CurrentAction->StartExecute();
+			OwnerTagBits.SetBit(Idx);
 		}
-
-		// TODO: on action change event
 	}
+}
 
-	if (CurrentAction)
+void UUtilityAIComponent::UpdateInterruptMatrix()
+{
+	const int32 NumActions = Actions.Num();
+	InterruptMatrix.Init(false, NumActions * NumActions);
+
+	for (int32 CurrentIdx = 0; CurrentIdx < NumActions; ++CurrentIdx)
 	{
-		CurrentAction->Tick(DeltaTime);
+		const FGameplayTagContainer& OwnedTags = GetActionOrDefault(CurrentIdx).OwnedTags;
+		for (int32 NewIdx = 0; NewIdx < NumActions; ++NewIdx)
+		{
+			if (OwnedTags.HasAny(GetActionOrDefault(NewIdx).InterruptActionsWithTags))
+			{
+				InterruptMatrix[CurrentIdx * NumActions + NewIdx] = true;
+			}
+		}
 	}
 }
+
+void UUtilityAIComponent::NotifyBlackboardKeyChanged(FName KeyName)
+{
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+		if (Action.bScoreOnlyWhenDirty && Action.DependencyBlackboardKeys.Contains(KeyName))
+		{
+			ActionStates[ActionIdx].bIsScoreDirty = true;
+		}
+	}
+}
+
+void UUtilityAIComponent::MarkAllScoresDirty()
+{
+	for (FUtilityAIActionState& State : ActionStates)
+	{
+		State.bIsScoreDirty = true;
+	}
+}
+
+void UUtilityAIComponent::OnPerceptionUpdated(const TArray<AActor*>& UpdatedActors)
+{
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+		if (Action.bScoreOnlyWhenDirty && Action.bDependsOnPerception)
+		{
+			ActionStates[ActionIdx].bIsScoreDirty = true;
+		}
+	}
+}
+
+void UUtilityAIComponent::BindPerceptionEvents(bool bBind)
+{
+	const AAIController* AIController = GetAIController();
+	UAIPerceptionComponent* PerceptionComp = AIController ? AIController->GetPerceptionComponent() : nullptr;
+	if (!PerceptionComp)
+	{
+		return;
+	}
+
+	if (bBind)
+	{
+		PerceptionComp->OnPerceptionUpdated.AddUniqueDynamic(this, &UUtilityAIComponent::OnPerceptionUpdated);
+	}
+	else
+	{
+		PerceptionComp->OnPerceptionUpdated.RemoveDynamic(this, &UUtilityAIComponent::OnPerceptionUpdated);
+	}
+}
+
+int32 UUtilityAIComponent::SelectAction()
+{
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_SelectAction);
+
+	SelectionStats.NumScored = 0;
+	SelectionStats.NumPruned = 0;
+
+	// actions are scored on the game thread, so skip copying the world state when nothing reads it
+	if (NeedsScoringSnapshot())
+	{
+		UpdateScoringSnapshot();
+	}
+
+	const int32 BestActionIdx = SelectionMode == EUtilityAISelectionMode::BranchAndBound
+		                            ? SelectActionBranchAndBound()
+		                            : SelectActionExhaustive();
+
+	SelectionStats.TotalScored += SelectionStats.NumScored;
+	SelectionStats.TotalPruned += SelectionStats.NumPruned;
+	INC_DWORD_STAT_BY(STAT_UtilityAI_ActionsScored, SelectionStats.NumScored);
+	INC_DWORD_STAT_BY(STAT_UtilityAI_ActionsPruned, SelectionStats.NumPruned);
+
+	return BestActionIdx;
+}
+
+int32 UUtilityAIComponent::SelectActionExhaustive()
+{
+	int32 BestActionIdx = INDEX_NONE;
+
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		ScoreAndCompareAction(ActionIdx, BestActionIdx);
+	}
+
+	return BestActionIdx;
+}
+
+int32 UUtilityAIComponent::SelectActionBranchAndBound()
+{
+	UpdateActionsByWeight();
+
+	int32 BestActionIdx = INDEX_NONE;
+
+	// score the current action first, so it keeps its hysteresis advantage regardless of its weight
+	const int32 CurrentActionIdx = CurrentAction ? CurrentAction->ActionIndex : INDEX_NONE;
+	if (CurrentActionIdx != INDEX_NONE)
+	{
+		ScoreAndCompareAction(CurrentActionIdx, BestActionIdx);
+	}
+
+	bool bIsPruning = false;
+	for (const int32 ActionIdx : ActionsByWeight)
+	{
+		if (ActionIdx == CurrentActionIdx)
+		{
+			continue;
+		}
+
+		// scores can't exceed their weight, so neither this nor any remaining action can be selected
+		bIsPruning = bIsPruning || (BestActionIdx != INDEX_NONE && GetActionScoreWeight(ActionIdx) <= GetScoreToBeat(BestActionIdx));
+		if (bIsPruning)
+		{
+			// don't leave scores from a previous decision behind, they would no longer be comparable
+			ClearActionScore(ActionIdx);
+			++SelectionStats.NumPruned;
+			continue;
+		}
+
+		ScoreAndCompareAction(ActionIdx, BestActionIdx);
+	}
+
+	return BestActionIdx;
+}
+
+void UUtilityAIComponent::ScoreAndCompareAction(int32 ActionIdx, int32& BestActionIdx)
+{
+	// let actions stop scoring early once they can't beat the best action
+	const float ScoreToBeat = GetScoreToBeat(BestActionIdx);
+	if (UpdateActionScore(ActionIdx, ScoreToBeat))
+	{
+		++SelectionStats.NumScored;
+	}
+
+	if (CanExecuteAction(ActionIdx) && (BestActionIdx == INDEX_NONE || ActionStates[ActionIdx].Score > ScoreToBeat))
+	{
+		BestActionIdx = ActionIdx;
+	}
+}
+
+float UUtilityAIComponent::GetScoreToBeat(int32 BestActionIdx) const
+{
+	if (BestActionIdx == INDEX_NONE)
+	{
+		return 0.f;
+	}
+	const FUtilityAIActionState& State = ActionStates[BestActionIdx];
+	return State.Score + (State.bIsExecuting ? ScoreHysteresisThreshold : 0.f);
+}
+
+void UUtilityAIComponent::UpdateActionsByWeight()
+{
+	if (ActionsByWeight.Num() != Actions.Num())
+	{
+		ActionsByWeight.Reset();
+		for (int32 Idx = 0; Idx < Actions.Num(); ++Idx)
+		{
+			ActionsByWeight.Add(Idx);
+		}
+	}
+
+	// weights can be changed at runtime, but rarely are, so only sort when needed
+	for (int32 Idx = 1; Idx < ActionsByWeight.Num(); ++Idx)
+	{
+		if (GetActionScoreWeight(ActionsByWeight[Idx - 1]) < GetActionScoreWeight(ActionsByWeight[Idx]))
+		{
+			ActionsByWeight.StableSort([this](int32 A, int32 B)
+			{
+				return GetActionScoreWeight(A) > GetActionScoreWeight(B);
+			});
+			break;
+		}
+	}
+}
+
+int32 UUtilityAIComponent::SelectBestScoredAction() const
+{
+	int32 BestActionIdx = INDEX_NONE;
+
+	// compare the current action first, so it keeps its hysteresis advantage
+	const int32 CurrentActionIdx = CurrentAction ? CurrentAction->ActionIndex : INDEX_NONE;
+	if (CurrentActionIdx != INDEX_NONE && CanExecuteAction(CurrentActionIdx))
+	{
+		BestActionIdx = CurrentActionIdx;
+	}
+
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		if (ActionIdx != BestActionIdx && CanExecuteAction(ActionIdx) &&
+			(BestActionIdx == INDEX_NONE || ActionStates[ActionIdx].Score > GetScoreToBeat(BestActionIdx)))
+		{
+			BestActionIdx = ActionIdx;
+		}
+	}
+
+	return BestActionIdx;
+}
+
+bool UUtilityAIComponent::UpdateActionScore(int32 ActionIdx, float ScoreToBeat)
+{
+	bool bIsDebugOnly = false;
+	if (ShouldUpdateActionScore(ActionIdx, bIsDebugOnly))
+	{
+		CalculateAndStoreActionScore(ActionIdx, ScoreToBeat, bIsDebugOnly);
+		return true;
+	}
+	return false;
+}
+
+bool UUtilityAIComponent::ShouldUpdateActionScore(int32 ActionIdx, bool& bOutIsDebugOnly)
+{
+	if (!Actions[ActionIdx] && !ActionSlots[ActionIdx].Definition->bCanScoreFromClassDefault)
+	{
+		// the class was recompiled and now needs an instance to be scored
+		CreateActionInstance(ActionIdx);
+	}
+
+	bool bShouldCalcScore = AreActionTagRequirementsMet(ActionIdx) && CanCalculateActionScore(ActionIdx) && IsActionScoreDirty(ActionIdx);
+	bOutIsDebugOnly = false;
+
+	if (bShouldCalcScore)
+	{
+		FUtilityAIActionState& State = ActionStates[ActionIdx];
+		State.bIsScoreDirty = false;
+		State.LastScoreTime = GetWorld()->GetTimeSeconds();
+	}
+
+#if WITH_GAMEPLAY_DEBUGGER
+	// allow calculating the score all the time, but only store the scoring elements,
+	// don't update the actual score when debugging
+	if (IsDebugCalculatingScores())
+	{
+		bOutIsDebugOnly = !bShouldCalcScore;
+		bShouldCalcScore = true;
+	}
+#endif
+
+	return bShouldCalcScore;
+}
+
+void UUtilityAIComponent::CalculateAndStoreActionScore(int32 ActionIdx, float ScoreToBeat, bool bIsDebugOnly)
+{
+#if WITH_GAMEPLAY_DEBUGGER
+	if (IsDebugCalculatingScores())
+	{
+		// evaluate every element so they can all be inspected
+		ScoreToBeat = -1.f;
+	}
+#endif
+
+	FUtilityAIScoringElements& Elements = GetMutableActionScoringElements(ActionIdx);
+	Elements.Reset();
+	Elements.bCaptureNames = ShouldCaptureScoreNames();
+	const float NewScore = CalculateActionScore(ActionIdx, ScoreToBeat, ActionStates[ActionIdx], Elements);
+
+	if (!bIsDebugOnly)
+	{
+		ActionStates[ActionIdx].Score = NewScore;
+		UpdateDeprecatedActionProperties(ActionIdx);
+	}
+}
+
+float UUtilityAIComponent::CalculateActionScore(int32 ActionIdx, float ScoreToBeat, const FUtilityAIActionState& State,
+                                                FUtilityAIScoringElements& OutElements)
+{
+	if (UUtilityAIAction* Action = Actions[ActionIdx])
+	{
+		return Action->CalculateScore(ScoreToBeat, OutElements, &State);
+	}
+
+	// shared actions only use data scoring, see FUtilityAIActionDefinition::bCanScoreFromClassDefault
+	const FUtilityAIActionSlot& Slot = ActionSlots[ActionIdx];
+	const UUtilityAIAction& DefaultAction = *Slot.Definition->DefaultAction;
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_UpdateScore);
+	UTILITYAI_TRACE_ACTION_SCOPE(DefaultAction);
+
+	const FUtilityAIConsiderationContext Context(DefaultAction, GetScoringSnapshot(), &State, this);
+	return DefaultAction.CalculateDataScore(Context, Slot.ScoreWeight, ScoreToBeat, OutElements) * Slot.ScoreWeight;
+}
+
+void UUtilityAIComponent::CalculatePendingScore(FUtilityAIPendingScore& PendingScore)
+{
+	float ScoreToBeat = 0.f;
+#if WITH_GAMEPLAY_DEBUGGER
+	if (IsDebugCalculatingScores())
+	{
+		ScoreToBeat = -1.f;
+	}
+#endif
+
+	PendingScore.Elements.Reset();
+	PendingScore.Elements.bCaptureNames = ShouldCaptureScoreNames();
+	// the game thread may change the live state while this runs, so only read the copy made when it was queued
+	PendingScore.Score = CalculateActionScore(PendingScore.ActionIndex, ScoreToBeat, PendingScore.State, PendingScore.Elements);
+}
+
+void UUtilityAIComponent::CommitPendingScore(FUtilityAIPendingScore& PendingScore)
+{
+	const int32 ActionIdx = PendingScore.ActionIndex;
+
+	// the score may have been frozen since it was calculated, e.g. if this action started executing
+	if (!CanCalculateActionScore(ActionIdx) && !PendingScore.bIsDebugOnly)
+	{
+		return;
+	}
+
+	Swap(GetMutableActionScoringElements(ActionIdx), PendingScore.Elements);
+	if (!PendingScore.bIsDebugOnly)
+	{
+		ActionStates[ActionIdx].Score = PendingScore.Score;
+		UpdateDeprecatedActionProperties(ActionIdx);
+	}
+}
+
+void UUtilityAIComponent::ClearActionScore(int32 ActionIdx)
+{
+	if (!CanCalculateActionScore(ActionIdx))
+	{
+		return;
+	}
+
+	FUtilityAIActionState& State = ActionStates[ActionIdx];
+	State.Score = 0.f;
+	State.bIsScoreDirty = true;
+	GetMutableActionScoringElements(ActionIdx).Reset();
+	UpdateDeprecatedActionProperties(ActionIdx);
+}
+
+bool UUtilityAIComponent::CanCalculateActionScore(int32 ActionIdx) const
+{
+	// shared actions have never executed, so can only have been frozen by their state
+	const UUtilityAIAction* Action = Actions[ActionIdx];
+	return Action ? Action->CanCalculateScore() : !ActionStates[ActionIdx].bIsScoreFrozen;
+}
+
+bool UUtilityAIComponent::IsActionScoreDirty(int32 ActionIdx) const
+{
+	const UUtilityAIAction& Action = GetActionOrDefault(ActionIdx);
+	const FUtilityAIActionState& State = ActionStates[ActionIdx];
+	if (!Action.bScoreOnlyWhenDirty || State.bIsScoreDirty)
+	{
+		return true;
+	}
+
+	// scores that stopped early are only an upper bound, and can't be compared against a different score to beat
+	if (GetActionScoringElements(ActionIdx).bStoppedEarly)
+	{
+		return true;
+	}
+
+	return Action.MaxScoreAge > 0.f && GetWorld()->GetTimeSeconds() - State.LastScoreTime >= Action.MaxScoreAge;
+}
+
+bool UUtilityAIComponent::IsActionScoringThreadSafe(int32 ActionIdx) const
+{
+	return GetActionOrDefault(ActionIdx).IsScoringThreadSafe();
+}
+
+bool UUtilityAIComponent::CanExecuteAction(int32 ActionIdx) const
+{
+	if (const UUtilityAIAction* Action = Actions[ActionIdx])
+	{
+		return Action->CanExecute();
+	}
+	return CheckTagRequirements(ActionIdx) && ActionStates[ActionIdx].Score > UE_SMALL_NUMBER;
+}
+
+void UUtilityAIComponent::UpdateDeprecatedActionProperties(int32 ActionIdx)
+{
+	if (UUtilityAIAction* Action = Actions[ActionIdx])
+	{
+		Action->UpdateDeprecatedProperties();
+	}
+}
+
+bool UUtilityAIComponent::ShouldCaptureScoreNames() const
+{
+#if UTILITYAI_WITH_SCORE_NAMES
+	return bCaptureScoreNames || IsDebugCalculatingScores();
+#else
+	return false;
+#endif
+}
+
+bool UUtilityAIComponent::IsDebugCalculatingScores() const
+{
+#if WITH_GAMEPLAY_DEBUGGER
+	return DebugCalculateScores == 1 || (DebugCalculateScores > 1 && ShouldDebugCalculateScores());
+#else
+	return false;
+#endif
+}
+
+void UUtilityAIComponent::TryActivateAction(UUtilityAIAction* NewAction)
+{
+	FUtilityAIDecisionRecorder* Recorder = FUtilityAIDecisionRecorder::Get();
+	const UUtilityAIAction* PreviousAction = CurrentAction;
+	const bool bWasBusy = Recorder && PreviousAction && IsBusy();
+
+	const bool bActivate = NewAction && NewAction != CurrentAction && CanActivateAction(NewAction);
+	if (bActivate)
+	{
+		NextAction = NewAction;
+		AbortCurrentAction();
+		NextAction = nullptr;
+
+		CurrentAction = NewAction;
+		INC_DWORD_STAT(STAT_UtilityAI_ActionSwitches);
+
+		if (CurrentAction)
+		{
+			CurrentAction->OnFinishedEvent.AddUObject(this, &UUtilityAIComponent::OnCurrentActionFinished);
+			CurrentAction->StartExecute();
+		}
+
+		// TODO: on action change event
+	}
+
+	if (Recorder)
+	{
+		EUtilityAIDecisionReason Reason = EUtilityAIDecisionReason::None;
+		if (NewAction)
+		{
+			if (NewAction == PreviousAction)
+			{
+				Reason = EUtilityAIDecisionReason::Kept;
+			}
+			else if (!bActivate)
+			{
+				Reason = EUtilityAIDecisionReason::Blocked;
+			}
+			else if (!PreviousAction)
+			{
+				Reason = EUtilityAIDecisionReason::Started;
+			}
+			else
+			{
+				Reason = bWasBusy ? EUtilityAIDecisionReason::Interrupted : EUtilityAIDecisionReason::Replaced;
+			}
+		}
+		Recorder->RecordDecision(*this, NewAction, CurrentAction, Reason);
+	}
+}
+
+void UUtilityAIComponent::TryActivateAction(int32 ActionIdx)
+{
+	if (ActionIdx != INDEX_NONE && !Actions[ActionIdx] && !IsActivationAllowed(ActionIdx))
+	{
+		// don't create an instance for an action that can't replace the current one
+		if (FUtilityAIDecisionRecorder* Recorder = FUtilityAIDecisionRecorder::Get())
+		{
+			Recorder->RecordDecision(*this, &GetActionOrDefault(ActionIdx), CurrentAction, EUtilityAIDecisionReason::Blocked);
+		}
+		return;
+	}
+
+	TryActivateAction(GetOrCreateActionInstance(ActionIdx));
+}
+
+bool UUtilityAIComponent::CanActivateAction(UUtilityAIAction* NewAction)
+{
+	if (NewAction->ActionIndex != INDEX_NONE)
+	{
+		return IsActivationAllowed(NewAction->ActionIndex);
+	}
+
+	// when busy, don't allow starting a new action, even if no action is active
+	if (!IsBusy())
+	{
+		return true;
+	}
+	return CurrentAction && CurrentAction->OwnedTags.HasAny(NewAction->InterruptActionsWithTags);
+}
+
+bool UUtilityAIComponent::IsActivationAllowed(int32 ActionIdx)
+{
+	// when busy, don't allow starting a new action, even if no action is active
+	if (!IsBusy())
+	{
+		return true;
+	}
+	if (!CurrentAction)
+	{
+		return false;
+	}
+
+	if (CurrentAction->ActionIndex == INDEX_NONE)
+	{
+		return CurrentAction->OwnedTags.HasAny(GetActionOrDefault(ActionIdx).InterruptActionsWithTags);
+	}
+
+	const int32 NumActions = Actions.Num();
+	if (InterruptMatrix.Num() != NumActions * NumActions)
+	{
+		UpdateInterruptMatrix();
+	}
+	return InterruptMatrix[CurrentAction->ActionIndex * NumActions + ActionIdx];
+}
+
+void UUtilityAIComponent::AbortCurrentAction()
+{
+	if (CurrentAction && CurrentAction->IsExecuting())
+	{
+		CurrentAction->OnFinishedEvent.RemoveAll(this);
+		CurrentAction->StartAbort();
+	}
+}
+
+UUtilityAISubsystem* UUtilityAIComponent::GetUtilityAISubsystem() const
+{
+	return UWorld::GetSubsystem<UUtilityAISubsystem>(GetWorld());
+}
+
+void UUtilityAIComponent::OnCurrentActionFinished()
+{
+	// clear the current action allowing it to re-execute if necessary
+	if (CurrentAction)
+	{
+		CurrentAction->OnFinishedEvent.RemoveAll(this);
+	}
+	CurrentAction = nullptr;
+}
+
+
+void UUtilityAIComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	TickActions(DeltaTime);
+}
+
+void UUtilityAIComponent::TickActions(float DeltaTime)
+{
+	UTILITYAI_SCOPE_CYCLE_COUNTER(STAT_UtilityAI_Tick);
+
+	if (!IsActive())
+	{
+		return;
+	}
+
+	UpdateCurrentAction();
+	TickCurrentAction(DeltaTime);
+}
+
+void UUtilityAIComponent::UpdateCurrentAction()
+{
+	if (bAsyncScoring)
+	{
+		UpdateCurrentActionAsync();
+		return;
+	}
+
+	TryActivateAction(SelectAction());
+}
+
+void UUtilityAIComponent::UpdateCurrentActionAsync()
+{
+	if (bIsAsyncDecisionPending)
+	{
+		// usually complete already, since it had a whole frame to run
+		AsyncScoringTask.Wait();
+		AsyncScoringTask = UE::Tasks::FTask();
+
+		for (FUtilityAIPendingScore& PendingScore : AsyncPendingScores)
+		{
+			CommitPendingScore(PendingScore);
+		}
+		AsyncPendingScores.Reset();
+		bIsAsyncDecisionPending = false;
+
+		FinishParallelScoring();
+	}
+
+	// start the next decision, scoring actions that aren't thread-safe now
+	PrepareParallelScoring(AsyncPendingScores);
+	bIsAsyncDecisionPending = true;
+
+	if (!AsyncPendingScores.IsEmpty())
+	{
+		AsyncScoringTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+		{
+			for (FUtilityAIPendingScore& PendingScore : AsyncPendingScores)
+			{
+				CalculatePendingScore(PendingScore);
+			}
+		});
+	}
+}
+
+void UUtilityAIComponent::CancelAsyncScoring()
+{
+	AsyncScoringTask.Wait();
+	AsyncScoringTask = UE::Tasks::FTask();
+	AsyncPendingScores.Reset();
+	bIsAsyncDecisionPending = false;
+}
+
+void UUtilityAIComponent::TickCurrentAction(float DeltaTime)
+{
+	// most actions are event driven, avoid the virtual call for those that don't tick
+	if (CurrentAction && CurrentAction->GetDefinition().NeedsTick())
+	{
+		CurrentAction->Tick(DeltaTime);
+	}
+}
+
+void UUtilityAIComponent::PrepareParallelScoring(TArray<FUtilityAIPendingScore>& OutPendingScores)
+{
+	SelectionStats.NumScored = 0;
+	SelectionStats.NumPruned = 0;
+
+	// always captured, since worker threads can't read the world directly
+	UpdateScoringSnapshot();
+
+	for (int32 ActionIdx = 0; ActionIdx < ActionSlots.Num(); ++ActionIdx)
+	{
+		bool bIsDebugOnly = false;
+		if (!ShouldUpdateActionScore(ActionIdx, bIsDebugOnly))
+		{
+			continue;
+		}
+
+		if (IsActionScoringThreadSafe(ActionIdx))
+		{
+			OutPendingScores.Add({this, ActionIdx, bIsDebugOnly, ActionStates[ActionIdx]});
+		}
+		else
+		{
+			// the best score isn't known until all actions are scored, so only stop early once a score can't be selected
+			CalculateAndStoreActionScore(ActionIdx, 0.f, bIsDebugOnly);
+		}
+		++SelectionStats.NumScored;
+	}
+}
+
+void UUtilityAIComponent::FinishParallelScoring()
+{
+	// every action is scored against a score to beat of 0, so none are pruned by weight
+	SelectionStats.NumPruned = 0;
+	SelectionStats.TotalScored += SelectionStats.NumScored;
+	SelectionStats.TotalPruned += SelectionStats.NumPruned;
+	INC_DWORD_STAT_BY(STAT_UtilityAI_ActionsScored, SelectionStats.NumScored);
+	INC_DWORD_STAT_BY(STAT_UtilityAI_ActionsPruned, SelectionStats.NumPruned);
+
+	TryActivateAction(SelectBestScoredAction());
+}
@@ -0,0 +1,86 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIConsideration.h"
+
+#include "UtilityAIAction.h"
+#include "UtilityAIComponent.h"
+
+
+AAIController* FUtilityAIConsiderationContext::GetAIController() const
+{
+	return Component ? Component->GetAIController() : Action.GetAIController();
+}
+
+
+float FUtilityAIResponseCurve::Evaluate(float X) const
+{
+	float Result = 0.f;
+	switch (Type)
+	{
+	case EUtilityAIResponseCurveType::Linear:
+		Result = Slope * (X - XShift) + YShift;
+		break;
+
+	case EUtilityAIResponseCurveType::Polynomial:
+		// clamp the base to avoid NaN results from fractional exponents
+		Result = Slope * FMath::Pow(FMath::Max(X - XShift, 0.f), Exponent) + YShift;
+		break;
+
+	case EUtilityAIResponseCurveType::Logistic:
+		Result = 1.f / (1.f + FMath::Exp(-Slope * (X - XShift))) + YShift;
+		break;
+
+	case EUtilityAIResponseCurveType::Step:
+		Result = X >= XShift ? 1.f : 0.f;
+		break;
+
+	case EUtilityAIResponseCurveType::Custom:
+		Result = CustomCurve.GetRichCurveConst()->Eval(X);
+		break;
+	}
+
+	Result = FMath::Clamp(Result, 0.f, 1.f);
+	return bInvert ? 1.f - Result : Result;
+}
+
+
+float UUtilityAIConsideration::Evaluate(const FUtilityAIConsiderationContext& Context) const
+{
+	if (!Input)
+	{
+		return 0.f;
+	}
+
+	const float Value = Input->GetValue(Context);
+	const float NormalizedValue = FMath::Clamp(FMath::GetRangePct(InputMin, InputMax, Value), 0.f, 1.f);
+	return FMath::Clamp(ResponseCurve.Evaluate(NormalizedValue) * Weight, 0.f, 1.f);
+}
+
+void UUtilityAIConsideration::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	UpdateCachedDisplayName();
+}
+
+void UUtilityAIConsideration::PostLoad()
+{
+	Super::PostLoad();
+
+	UpdateCachedDisplayName();
+}
+
+#if WITH_EDITOR
+void UUtilityAIConsideration::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	UpdateCachedDisplayName();
+}
+#endif
+
+void UUtilityAIConsideration::UpdateCachedDisplayName()
+{
+	CachedDisplayName = DisplayName.IsEmpty() ? GetFName() : FName(*DisplayName);
+}
@@ -0,0 +1,482 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIDecisionRecorder.h"
+
+#include "UtilityAIAction.h"
+#include "UtilityAIComponent.h"
+#include "UtilityAIModule.h"
+#include "UtilityAIScoringSnapshot.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/Paths.h"
+
+
+TAutoConsoleVariable<int32> CVarDecisionRecordingMaxMB(
+	TEXT("ai.Utility.DecisionRecording.MaxMB"),
+	64,
+	TEXT("The size of the decision recording ring buffer, or the max size of records waiting to be written to a file, in megabytes."));
+
+TAutoConsoleVariable<bool> CVarDecisionRecordingElements(
+	TEXT("ai.Utility.DecisionRecording.Elements"),
+	true,
+	TEXT("Record the scoring elements of each action that was scored. Element names are only recorded when captured for debugging."));
+
+
+namespace UtilityAIDecisionRecorder
+{
+	void WriteUInt8(TArray<uint8>& Data, uint8 Value)
+	{
+		Data.Add(Value);
+	}
+
+	void WriteVarInt(TArray<uint8>& Data, uint64 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Data.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+		Data.Add(static_cast<uint8>(Value));
+	}
+
+	void WriteFloat(TArray<uint8>& Data, float Value)
+	{
+		uint32 Bits;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		for (int32 Shift = 0; Shift < 32; Shift += 8)
+		{
+			Data.Add(static_cast<uint8>(Bits >> Shift));
+		}
+	}
+
+	void WriteDouble(TArray<uint8>& Data, double Value)
+	{
+		uint64 Bits;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		for (int32 Shift = 0; Shift < 64; Shift += 8)
+		{
+			Data.Add(static_cast<uint8>(Bits >> Shift));
+		}
+	}
+
+	void WriteHeader(FArchive& Ar)
+	{
+		uint32 Magic = FUtilityAIDecisionTraceFormat::Magic;
+		uint32 Version = FUtilityAIDecisionTraceFormat::Version;
+		Ar << Magic;
+		Ar << Version;
+	}
+
+	void StartRecording(const TArray<FString>& Args)
+	{
+		const int64 MaxBytes = static_cast<int64>(FMath::Max(CVarDecisionRecordingMaxMB.GetValueOnGameThread(), 1)) * 1024 * 1024;
+		if (Args.IsEmpty())
+		{
+			FUtilityAIDecisionRecorder::Start(EUtilityAIDecisionRecorderMode::RingBuffer, FString(), MaxBytes);
+			UE_LOG(LogUtilityAI, Display, TEXT("Recording decisions to a %lld MB ring buffer"), MaxBytes / (1024 * 1024));
+			return;
+		}
+
+		const FString Filename = FUtilityAIDecisionRecorder::GetTraceFilename(Args[0]);
+		if (FUtilityAIDecisionRecorder::Start(EUtilityAIDecisionRecorderMode::File, Filename, MaxBytes))
+		{
+			UE_LOG(LogUtilityAI, Display, TEXT("Recording decisions to %s"), *Filename);
+		}
+	}
+
+	void SaveRecording(const TArray<FString>& Args)
+	{
+		FUtilityAIDecisionRecorder* Recorder = FUtilityAIDecisionRecorder::Get();
+		if (!Recorder || Recorder->GetMode() != EUtilityAIDecisionRecorderMode::RingBuffer)
+		{
+			UE_LOG(LogUtilityAI, Error, TEXT("Not recording decisions to a ring buffer"));
+			return;
+		}
+
+		const FString Filename = FUtilityAIDecisionRecorder::GetTraceFilename(
+			Args.IsEmpty() ? FString::Printf(TEXT("Decisions-%s.uaid"), *FDateTime::Now().ToString()) : Args[0]);
+		Recorder->SaveRingBuffer(Filename);
+	}
+
+	void PrintRecording(const TArray<FString>& Args)
+	{
+		if (Args.IsEmpty())
+		{
+			UE_LOG(LogUtilityAI, Error, TEXT("Usage: ai.Utility.PrintDecisionRecording <File> [AgentName]"));
+			return;
+		}
+
+		const FString Filename = FUtilityAIDecisionRecorder::GetTraceFilename(Args[0]);
+		FUtilityAIDecisionTraceReader Reader;
+		if (!Reader.Open(Filename))
+		{
+			UE_LOG(LogUtilityAI, Error, TEXT("%s is not a valid decision recording"), *Filename);
+			return;
+		}
+
+		const FString AgentFilter = Args.Num() > 1 ? Args[1] : FString();
+		FUtilityAIDecisionTraceRecord Record;
+		while (Reader.ReadNext(Record))
+		{
+			if (!AgentFilter.IsEmpty() && !Record.AgentName.Contains(AgentFilter))
+			{
+				continue;
+			}
+
+			UE_LOG(LogUtilityAI, Display, TEXT("[%.3f] %s: %s %s, current %s"), Record.WorldTime, *Record.AgentName,
+			       LexToString(Record.Reason), *Record.SelectedAction, *Record.CurrentAction);
+			if (Record.bHasTags)
+			{
+				UE_LOG(LogUtilityAI, Display, TEXT("    Tags: %s"), *FString::Join(Record.Tags, TEXT(", ")));
+			}
+			for (const FUtilityAIDecisionTraceAction& Action : Record.Actions)
+			{
+				FString Elements;
+				for (const FUtilityAIDecisionTraceElement& Element : Action.Elements)
+				{
+					Elements += FString::Printf(TEXT(" %s=%.3f"), Element.Name.IsEmpty() ? TEXT("?") : *Element.Name, Element.Score);
+				}
+				UE_LOG(LogUtilityAI, Display, TEXT("    %s%s %.3f%s%s"), *Action.Name, Action.bExecuting ? TEXT(" (executing)") : TEXT(""),
+				       Action.Score, Action.bScored ? TEXT("") : TEXT(" (not scored)"), *Elements);
+			}
+		}
+
+		if (Reader.HasError())
+		{
+			UE_LOG(LogUtilityAI, Warning, TEXT("%s is truncated or invalid"), *Filename);
+		}
+	}
+
+	FAutoConsoleCommand StartCommand(
+		TEXT("ai.Utility.StartDecisionRecording"),
+		TEXT("Record all utility AI decisions. Usage: ai.Utility.StartDecisionRecording [File]. ")
+		TEXT("Streams to File if given, otherwise keeps recent decisions in a ring buffer to save with ai.Utility.SaveDecisionRecording."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&StartRecording));
+
+	FAutoConsoleCommand StopCommand(
+		TEXT("ai.Utility.StopDecisionRecording"),
+		TEXT("Stop recording utility AI decisions."),
+		FConsoleCommandDelegate::CreateStatic(&FUtilityAIDecisionRecorder::Stop));
+
+	FAutoConsoleCommand SaveCommand(
+		TEXT("ai.Utility.SaveDecisionRecording"),
+		TEXT("Save the decision recording ring buffer to a file. Usage: ai.Utility.SaveDecisionRecording [File]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&SaveRecording));
+
+	FAutoConsoleCommand PrintCommand(
+		TEXT("ai.Utility.PrintDecisionRecording"),
+		TEXT("Print the decisions in a recording to the log. Usage: ai.Utility.PrintDecisionRecording <File> [AgentName]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&PrintRecording));
+}
+
+
+FUtilityAIDecisionRecorder* FUtilityAIDecisionRecorder::ActiveRecorder = nullptr;
+
+FUtilityAIDecisionRecorder::FUtilityAIDecisionRecorder(EUtilityAIDecisionRecorderMode InMode, TUniquePtr<FArchive> InFileWriter, int64 InMaxBytes)
+	: Mode(InMode),
+	  MaxBytes(InMaxBytes),
+	  WriterPipe(TEXT("UtilityAIDecisionRecorder")),
+	  FileWriter(MoveTemp(InFileWriter))
+{
+	bRecordElements = CVarDecisionRecordingElements.GetValueOnGameThread();
+	Block.Reserve(BlockSize);
+
+	// hand off records every frame, so they aren't held on the game thread longer than needed
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FUtilityAIDecisionRecorder::SubmitBlock);
+}
+
+FUtilityAIDecisionRecorder::~FUtilityAIDecisionRecorder()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	SubmitBlock();
+	WriterPipe.WaitUntilEmpty();
+
+	if (FileWriter)
+	{
+		FileWriter->Close();
+		if (NumDroppedBlocks.load() > 0)
+		{
+			UE_LOG(LogUtilityAI, Warning, TEXT("Dropped %d blocks of decision records because the file couldn't keep up"), NumDroppedBlocks.load());
+		}
+	}
+}
+
+bool FUtilityAIDecisionRecorder::Start(EUtilityAIDecisionRecorderMode Mode, const FString& Filename, int64 MaxBytes)
+{
+	Stop();
+
+	TUniquePtr<FArchive> FileWriter;
+	if (Mode == EUtilityAIDecisionRecorderMode::File)
+	{
+		FileWriter.Reset(IFileManager::Get().CreateFileWriter(*Filename));
+		if (!FileWriter)
+		{
+			UE_LOG(LogUtilityAI, Error, TEXT("Failed to open %s for recording decisions"), *Filename);
+			return false;
+		}
+		UtilityAIDecisionRecorder::WriteHeader(*FileWriter);
+	}
+
+	ActiveRecorder = new FUtilityAIDecisionRecorder(Mode, MoveTemp(FileWriter), MaxBytes);
+	return true;
+}
+
+void FUtilityAIDecisionRecorder::Stop()
+{
+	FUtilityAIDecisionRecorder* Recorder = ActiveRecorder;
+	ActiveRecorder = nullptr;
+	delete Recorder;
+}
+
+FString FUtilityAIDecisionRecorder::GetTraceFilename(const FString& Filename)
+{
+	if (FPaths::IsRelative(Filename))
+	{
+		return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("UtilityAI"), Filename);
+	}
+	return Filename;
+}
+
+void FUtilityAIDecisionRecorder::RecordDecision(const UUtilityAIComponent& Component, const UUtilityAIAction* SelectedAction,
+                                                const UUtilityAIAction* CurrentAction, EUtilityAIDecisionReason Reason)
+{
+	using namespace UtilityAIDecisionRecorder;
+	using FFormat = FUtilityAIDecisionTraceFormat;
+
+	FAgent& Agent = FindOrAddAgent(Component);
+	const UWorld* World = Component.GetWorld();
+	const double WorldTime = World ? World->GetTimeSeconds() : 0.0;
+
+	// tags rarely change, so only record them when they do, or once per block so that each block is self-contained
+	const FUtilityAIScoringSnapshot* Snapshot = Component.GetScoringSnapshot();
+	const bool bRecordTags = Snapshot && (Agent.TagsBlock != BlockSerial || Agent.TagsSerial != Component.GetOwnerTagsSerial());
+
+	WriteUInt8(Block, static_cast<uint8>(FFormat::ERecordType::Decision));
+	WriteVarInt(Block, Agent.Id);
+	WriteDouble(Block, WorldTime);
+	WriteVarInt(Block, GFrameCounter);
+	WriteUInt8(Block, static_cast<uint8>(Reason));
+	WriteVarInt(Block, SelectedAction ? GetNameId(SelectedAction->GetClass()->GetFName()) : 0);
+	WriteVarInt(Block, CurrentAction ? GetNameId(CurrentAction->GetClass()->GetFName()) : 0);
+	WriteUInt8(Block, static_cast<uint8>(bRecordTags ? FFormat::DF_HasTags : 0));
+
+	if (bRecordTags)
+	{
+		WriteVarInt(Block, Snapshot->OwnerTags.Num());
+		for (const FGameplayTag& Tag : Snapshot->OwnerTags)
+		{
+			WriteVarInt(Block, GetNameId(Tag.GetTagName()));
+		}
+		Agent.TagsSerial = Component.GetOwnerTagsSerial();
+		Agent.TagsBlock = BlockSerial;
+	}
+
+	// actions without an instance are scored from their class default, so read them through the component
+	const int32 NumActions = Component.GetNumActions();
+	const TArray<FUtilityAIActionState>& States = Component.GetAllActionStates();
+	WriteVarInt(Block, NumActions);
+	for (int32 Idx = 0; Idx < NumActions; ++Idx)
+	{
+		const FUtilityAIActionState& State = States[Idx];
+
+		// async scores are calculated after the previous decision on the same frame, so include that time
+		const bool bScored = State.LastScoreTime >= Agent.LastRecordTime;
+		const bool bHasElements = bScored && bRecordElements;
+
+		WriteVarInt(Block, GetNameId(Component.GetActionClass(Idx)->GetFName()));
+		WriteFloat(Block, State.Score);
+		WriteUInt8(Block, static_cast<uint8>((bScored ? FFormat::AF_Scored : 0) |
+		                                     (State.bIsExecuting ? FFormat::AF_Executing : 0) |
+		                                     (bHasElements ? FFormat::AF_HasElements : 0)));
+
+		if (bHasElements)
+		{
+			const FUtilityAIScoringElements& Elements = Component.GetActionScoringElements(Idx);
+			WriteUInt8(Block, static_cast<uint8>(Elements.Operation));
+			WriteVarInt(Block, Elements.NumSkipped);
+			WriteVarInt(Block, Elements.Scores.Num());
+			for (int32 ElementIdx = 0; ElementIdx < Elements.Scores.Num(); ++ElementIdx)
+			{
+				WriteVarInt(Block, GetNameId(Elements.GetName(ElementIdx)));
+				WriteFloat(Block, Elements.Scores[ElementIdx]);
+			}
+		}
+	}
+
+	Agent.LastRecordTime = WorldTime;
+
+	if (Block.Num() >= BlockSize)
+	{
+		SubmitBlock();
+	}
+}
+
+void FUtilityAIDecisionRecorder::RemoveAgent(const UUtilityAIComponent& Component)
+{
+	Agents.Remove(&Component);
+}
+
+bool FUtilityAIDecisionRecorder::SaveRingBuffer(const FString& Filename)
+{
+	if (Mode != EUtilityAIDecisionRecorderMode::RingBuffer)
+	{
+		return false;
+	}
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+	{
+		UE_LOG(LogUtilityAI, Error, TEXT("Failed to open %s for saving decisions"), *Filename);
+		return false;
+	}
+
+	SubmitBlock();
+
+	WriterPipe.Launch(UE_SOURCE_LOCATION, [this, Writer = MoveTemp(Writer), Filename]()
+	{
+		UtilityAIDecisionRecorder::WriteHeader(*Writer);
+		for (const TArray<uint8>& RingBlock : RingBlocks)
+		{
+			Writer->Serialize(const_cast<uint8*>(RingBlock.GetData()), RingBlock.Num());
+		}
+		Writer->Close();
+
+		UE_LOG(LogUtilityAI, Display, TEXT("Saved decision recording to %s"), *Filename);
+	});
+	return true;
+}
+
+uint32 FUtilityAIDecisionRecorder::GetNameId(FName Name)
+{
+	if (Name.IsNone())
+	{
+		return 0;
+	}
+
+	FNameEntry& Entry = NameIds.FindOrAdd(Name);
+	if (Entry.Id == 0)
+	{
+		Entry.Id = NextNameId++;
+	}
+
+	if (Entry.DefinedBlock != BlockSerial)
+	{
+		Entry.DefinedBlock = BlockSerial;
+
+		const FTCHARToUTF8 Utf8(*Name.ToString());
+		UtilityAIDecisionRecorder::WriteUInt8(BlockDefinitions, static_cast<uint8>(FUtilityAIDecisionTraceFormat::ERecordType::Name));
+		UtilityAIDecisionRecorder::WriteVarInt(BlockDefinitions, Entry.Id);
+		UtilityAIDecisionRecorder::WriteVarInt(BlockDefinitions, Utf8.Length());
+		BlockDefinitions.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+	return Entry.Id;
+}
+
+FUtilityAIDecisionRecorder::FAgent& FUtilityAIDecisionRecorder::FindOrAddAgent(const UUtilityAIComponent& Component)
+{
+	FAgent& Agent = Agents.FindOrAdd(&Component);
+	if (Agent.Id == 0)
+	{
+		Agent.Id = NextAgentId++;
+
+		const AActor* Owner = Component.GetOwner();
+		Agent.Name = Owner ? Owner->GetFName() : Component.GetFName();
+	}
+
+	if (Agent.DefinedBlock != BlockSerial)
+	{
+		Agent.DefinedBlock = BlockSerial;
+
+		const uint32 NameId = GetNameId(Agent.Name);
+		UtilityAIDecisionRecorder::WriteUInt8(BlockDefinitions, static_cast<uint8>(FUtilityAIDecisionTraceFormat::ERecordType::Agent));
+		UtilityAIDecisionRecorder::WriteVarInt(BlockDefinitions, Agent.Id);
+		UtilityAIDecisionRecorder::WriteVarInt(BlockDefinitions, NameId);
+	}
+	return Agent;
+}
+
+void FUtilityAIDecisionRecorder::SubmitBlock()
+{
+	if (Block.IsEmpty())
+	{
+		return;
+	}
+
+	// drop records rather than growing without bound when the file can't keep up,
+	// every block defines what it uses, so the following blocks can still be read
+	TArray<uint8> Data;
+	if (Mode == EUtilityAIDecisionRecorderMode::File && PendingBytes.load() + BlockDefinitions.Num() + Block.Num() > MaxBytes)
+	{
+		NumDroppedBlocks.fetch_add(1);
+		BlockDefinitions.Reset();
+	}
+	else
+	{
+		Data = MoveTemp(BlockDefinitions);
+		Data.Append(Block);
+	}
+	Block.Reset();
+
+	// the next block starts over with its own definitions and tags
+	++BlockSerial;
+	PruneDefinitions();
+
+	if (Data.IsEmpty())
+	{
+		return;
+	}
+
+	PendingBytes.fetch_add(Data.Num());
+	WriterPipe.Launch(UE_SOURCE_LOCATION, [this, Data = MoveTemp(Data)]() mutable
+	{
+		ConsumeBlock(MoveTemp(Data));
+	});
+}
+
+void FUtilityAIDecisionRecorder::PruneDefinitions()
+{
+	// names are redefined by every block that uses them, so ids can be reused between blocks
+	if (NameIds.Num() > MaxNames)
+	{
+		NameIds.Reset();
+		NextNameId = 1;
+	}
+
+	// components are normally removed when they end play, but catch any that were destroyed without it
+	if (Agents.Num() > NumAgentsAfterPrune * 2 + 64)
+	{
+		for (auto It = Agents.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+			}
+		}
+		NumAgentsAfterPrune = Agents.Num();
+	}
+}
+
+void FUtilityAIDecisionRecorder::ConsumeBlock(TArray<uint8>&& Data)
+{
+	const int64 NumBytes = Data.Num();
+
+	if (FileWriter)
+	{
+		FileWriter->Serialize(Data.GetData(), NumBytes);
+	}
+	else
+	{
+		RingBytes += NumBytes;
+		RingBlocks.Add(MoveTemp(Data));
+		while (RingBytes > MaxBytes && RingBlocks.Num() > 1)
+		{
+			RingBytes -= RingBlocks.PopFrontValue().Num();
+		}
+	}
+
+	PendingBytes.fetch_sub(NumBytes);
+}
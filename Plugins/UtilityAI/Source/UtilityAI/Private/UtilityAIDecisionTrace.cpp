@@ -0,0 +1,230 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIDecisionTrace.h"
+
+#include "HAL/FileManager.h"
+
+
+const TCHAR* LexToString(EUtilityAIDecisionReason Reason)
+{
+	switch (Reason)
+	{
+	case EUtilityAIDecisionReason::None:
+		return TEXT("None");
+	case EUtilityAIDecisionReason::Kept:
+		return TEXT("Kept");
+	case EUtilityAIDecisionReason::Started:
+		return TEXT("Started");
+	case EUtilityAIDecisionReason::Replaced:
+		return TEXT("Replaced");
+	case EUtilityAIDecisionReason::Interrupted:
+		return TEXT("Interrupted");
+	case EUtilityAIDecisionReason::Blocked:
+		return TEXT("Blocked");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+
+FUtilityAIDecisionTraceReader::FUtilityAIDecisionTraceReader() = default;
+
+FUtilityAIDecisionTraceReader::~FUtilityAIDecisionTraceReader() = default;
+
+bool FUtilityAIDecisionTraceReader::Open(const FString& Filename)
+{
+	Names.Reset();
+	AgentNames.Reset();
+	bHasError = false;
+
+	Archive.Reset(IFileManager::Get().CreateFileReader(*Filename));
+	if (!Archive)
+	{
+		bHasError = true;
+		return false;
+	}
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Archive << Magic;
+	*Archive << Version;
+	if (Archive->IsError() || Magic != FUtilityAIDecisionTraceFormat::Magic || Version != FUtilityAIDecisionTraceFormat::Version)
+	{
+		bHasError = true;
+		Archive.Reset();
+		return false;
+	}
+	return true;
+}
+
+bool FUtilityAIDecisionTraceReader::ReadNext(FUtilityAIDecisionTraceRecord& OutRecord)
+{
+	using ERecordType = FUtilityAIDecisionTraceFormat::ERecordType;
+
+	while (Archive && !bHasError && !Archive->AtEnd())
+	{
+		uint8 Type = 0;
+		*Archive << Type;
+
+		switch (static_cast<ERecordType>(Type))
+		{
+		case ERecordType::Name:
+		{
+			const uint32 Id = static_cast<uint32>(ReadVarInt());
+			const uint64 Length = ReadVarInt();
+			if (Length > 1024 || bHasError)
+			{
+				bHasError = true;
+				break;
+			}
+			TArray<UTF8CHAR> Chars;
+			Chars.SetNumUninitialized(static_cast<int32>(Length));
+			Archive->Serialize(Chars.GetData(), Chars.Num());
+			Names.Add(Id, FString(FUtf8StringView(Chars.GetData(), Chars.Num())));
+			break;
+		}
+		case ERecordType::Agent:
+		{
+			const uint32 AgentId = static_cast<uint32>(ReadVarInt());
+			AgentNames.Add(AgentId, ReadNameId());
+			break;
+		}
+		case ERecordType::Decision:
+			if (ReadDecision(OutRecord))
+			{
+				return true;
+			}
+			break;
+		default:
+			bHasError = true;
+			break;
+		}
+
+		bHasError |= Archive->IsError();
+	}
+	return false;
+}
+
+uint64 FUtilityAIDecisionTraceReader::ReadVarInt()
+{
+	uint64 Value = 0;
+	for (int32 Shift = 0; Shift < 64; Shift += 7)
+	{
+		uint8 Byte = 0;
+		*Archive << Byte;
+		Value |= static_cast<uint64>(Byte & 0x7f) << Shift;
+		if ((Byte & 0x80) == 0 || Archive->IsError())
+		{
+			return Value;
+		}
+	}
+	bHasError = true;
+	return Value;
+}
+
+float FUtilityAIDecisionTraceReader::ReadFloat()
+{
+	float Value = 0.f;
+	*Archive << Value;
+	return Value;
+}
+
+double FUtilityAIDecisionTraceReader::ReadDouble()
+{
+	double Value = 0.0;
+	*Archive << Value;
+	return Value;
+}
+
+const FString& FUtilityAIDecisionTraceReader::ReadNameId()
+{
+	static const FString NoneName;
+	const uint32 Id = static_cast<uint32>(ReadVarInt());
+	if (Id == 0)
+	{
+		return NoneName;
+	}
+	if (const FString* Name = Names.Find(Id))
+	{
+		return *Name;
+	}
+	bHasError = true;
+	return NoneName;
+}
+
+bool FUtilityAIDecisionTraceReader::ReadDecision(FUtilityAIDecisionTraceRecord& OutRecord)
+{
+	// guards against reading huge counts from a corrupt trace
+	constexpr uint64 MaxCount = 4096;
+
+	OutRecord.AgentId = static_cast<uint32>(ReadVarInt());
+	const FString* AgentName = AgentNames.Find(OutRecord.AgentId);
+	OutRecord.AgentName = AgentName ? *AgentName : FString();
+	OutRecord.WorldTime = ReadDouble();
+	OutRecord.FrameNumber = ReadVarInt();
+
+	uint8 Reason = 0;
+	*Archive << Reason;
+	OutRecord.Reason = static_cast<EUtilityAIDecisionReason>(Reason);
+	OutRecord.SelectedAction = ReadNameId();
+	OutRecord.CurrentAction = ReadNameId();
+
+	uint8 Flags = 0;
+	*Archive << Flags;
+	OutRecord.bHasTags = (Flags & FUtilityAIDecisionTraceFormat::DF_HasTags) != 0;
+	OutRecord.Tags.Reset();
+	if (OutRecord.bHasTags)
+	{
+		const uint64 NumTags = ReadVarInt();
+		for (uint64 Idx = 0; Idx < NumTags && Idx < MaxCount && !bHasError; ++Idx)
+		{
+			OutRecord.Tags.Add(ReadNameId());
+		}
+		bHasError |= NumTags > MaxCount;
+	}
+
+	const uint64 NumActions = ReadVarInt();
+	bHasError |= NumActions > MaxCount;
+	OutRecord.Actions.SetNum(bHasError ? 0 : static_cast<int32>(NumActions));
+	for (FUtilityAIDecisionTraceAction& Action : OutRecord.Actions)
+	{
+		Action.Name = ReadNameId();
+		Action.Score = ReadFloat();
+
+		uint8 ActionFlags = 0;
+		*Archive << ActionFlags;
+		Action.bScored = (ActionFlags & FUtilityAIDecisionTraceFormat::AF_Scored) != 0;
+		Action.bExecuting = (ActionFlags & FUtilityAIDecisionTraceFormat::AF_Executing) != 0;
+		Action.bHasElements = (ActionFlags & FUtilityAIDecisionTraceFormat::AF_HasElements) != 0;
+		Action.Elements.Reset();
+		if (Action.bHasElements)
+		{
+			uint8 Operation = 0;
+			*Archive << Operation;
+			Action.Operation = static_cast<EUtilityAIScoreOperation>(Operation);
+			Action.NumSkipped = static_cast<int32>(ReadVarInt());
+
+			const uint64 NumElements = ReadVarInt();
+			if (NumElements > MaxCount)
+			{
+				bHasError = true;
+				break;
+			}
+			Action.Elements.SetNum(static_cast<int32>(NumElements));
+			for (FUtilityAIDecisionTraceElement& Element : Action.Elements)
+			{
+				Element.Name = ReadNameId();
+				Element.Score = ReadFloat();
+			}
+		}
+
+		if (bHasError || Archive->IsError())
+		{
+			break;
+		}
+	}
+
+	bHasError |= Archive->IsError();
+	return !bHasError;
+}
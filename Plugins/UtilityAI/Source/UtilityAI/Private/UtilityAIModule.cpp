@@ -2,6 +2,9 @@
 
 #include "UtilityAIModule.h"
 
+#include "UtilityAIActionDefinition.h"
+#include "UtilityAIDecisionRecorder.h"
+
 
 #if WITH_GAMEPLAY_DEBUGGER
 #include "GameplayDebugger.h"
@@ -14,6 +17,18 @@ DEFINE_LOG_CATEGORY(LogUtilityAI)
 
 void FUtilityAIModule::StartupModule()
 {
+#if WITH_EDITOR
+	// action definitions cache which Blueprint events are implemented, rebuild them when Blueprints are recompiled
+	ObjectsReplacedHandle = FCoreUObjectDelegates::OnObjectsReplaced.AddLambda([](const TMap<UObject*, UObject*>&)
+	{
+		FUtilityAIActionDefinition::RefreshAll();
+	});
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason)
+	{
+		FUtilityAIActionDefinition::RefreshAll();
+	});
+#endif
+
 #if WITH_GAMEPLAY_DEBUGGER
 	IGameplayDebugger& GameplayDebuggerModule = IGameplayDebugger::Get();
 	GameplayDebuggerModule.RegisterCategory(
@@ -25,6 +40,13 @@ void FUtilityAIModule::StartupModule()
 
 void FUtilityAIModule::ShutdownModule()
 {
+	FUtilityAIDecisionRecorder::Stop();
+
+#if WITH_EDITOR
+	FCoreUObjectDelegates::OnObjectsReplaced.Remove(ObjectsReplacedHandle);
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+#endif
+
 #if WITH_GAMEPLAY_DEBUGGER
 	if (IGameplayDebugger::IsAvailable())
 	{
@@ -29,3 +29,55 @@ float UUtilityAIStatics::CombineWeightedScores(TArray<float> Scores, TArray<floa
 
 	return TotalScore / TotalWeight;
 }
+
+float UUtilityAIStatics::CombineScores(TConstArrayView<float> Scores, EUtilityAIScoreOperation Operation)
+{
+	if (Scores.IsEmpty())
+	{
+		return 0.f;
+	}
+
+	float Result = 0.f;
+	switch (Operation)
+	{
+	case EUtilityAIScoreOperation::Multiply:
+		Result = 1.f;
+		for (const float ElementScore : Scores)
+		{
+			Result *= ElementScore;
+		}
+		break;
+
+	case EUtilityAIScoreOperation::Max:
+		for (const float ElementScore : Scores)
+		{
+			Result = FMath::Max(Result, ElementScore);
+		}
+		break;
+
+	case EUtilityAIScoreOperation::Min:
+		Result = 1.f;
+		for (const float ElementScore : Scores)
+		{
+			Result = FMath::Min(Result, ElementScore);
+		}
+		break;
+	}
+	return Result;
+}
+
+TArray<float> UUtilityAIStatics::GetScoringElementScores(const FUtilityAIScoringElements& ScoringElements)
+{
+	return TArray<float>(ScoringElements.Scores);
+}
+
+TArray<FName> UUtilityAIStatics::GetScoringElementNames(const FUtilityAIScoringElements& ScoringElements)
+{
+	TArray<FName> Names;
+	Names.Reserve(ScoringElements.Scores.Num());
+	for (int32 Idx = 0; Idx < ScoringElements.Scores.Num(); ++Idx)
+	{
+		Names.Add(ScoringElements.GetName(Idx));
+	}
+	return Names;
+}
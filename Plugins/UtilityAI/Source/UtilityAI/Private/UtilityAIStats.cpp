@@ -0,0 +1,18 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIStats.h"
+
+
+DEFINE_STAT(STAT_UtilityAI_Tick);
+DEFINE_STAT(STAT_UtilityAI_SelectAction);
+DEFINE_STAT(STAT_UtilityAI_UpdateScore);
+DEFINE_STAT(STAT_UtilityAI_BlueprintScore);
+DEFINE_STAT(STAT_UtilityAI_StartExecute);
+DEFINE_STAT(STAT_UtilityAI_StartAbort);
+
+DEFINE_STAT(STAT_UtilityAI_ActionsScored);
+DEFINE_STAT(STAT_UtilityAI_ActionsPruned);
+DEFINE_STAT(STAT_UtilityAI_ActionSwitches);
+
+UE_TRACE_CHANNEL_DEFINE(UtilityAIChannel);
@@ -0,0 +1,359 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAISubsystem.h"
+
+#include "AIController.h"
+#include "UtilityAIComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+
+TAutoConsoleVariable<float> CVarDecisionBudgetMs(
+	TEXT("ai.Utility.DecisionBudgetMs"),
+	0.f,
+	TEXT("The max time in milliseconds that the UtilityAISubsystem spends selecting actions each frame. 0 is unlimited."));
+
+TAutoConsoleVariable<float> CVarMaxDecisionStaleness(
+	TEXT("ai.Utility.MaxDecisionStaleness"),
+	1.f,
+	TEXT("The max time in seconds an agent can go without selecting an action, regardless of the decision budget."));
+
+TAutoConsoleVariable<float> CVarPriorityDistance(
+	TEXT("ai.Utility.PriorityDistance"),
+	5000.f,
+	TEXT("The distance from the nearest viewer at which an agent no longer gains decision priority."));
+
+TAutoConsoleVariable<float> CVarPriorityDistanceWeight(
+	TEXT("ai.Utility.PriorityDistanceWeight"),
+	1.f,
+	TEXT("How much being close to a viewer increases an agent's decision priority."));
+
+TAutoConsoleVariable<float> CVarPriorityCombatWeight(
+	TEXT("ai.Utility.PriorityCombatWeight"),
+	1.f,
+	TEXT("How much being in combat increases an agent's decision priority."));
+
+TAutoConsoleVariable<float> CVarPriorityStalenessWeight(
+	TEXT("ai.Utility.PriorityStalenessWeight"),
+	1.f,
+	TEXT("How much the time since an agent's last decision increases its decision priority."));
+
+TAutoConsoleVariable<bool> CVarParallelScoring(
+	TEXT("ai.Utility.ParallelScoring"),
+	false,
+	TEXT("Score actions with thread-safe scoring on worker threads, for all agents deciding in the same frame."));
+
+
+void UUtilityAISubsystem::RegisterComponent(UUtilityAIComponent* Component)
+{
+	if (!Component || Component->SubsystemTickIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	FUtilityAIAgentTickInfo& Agent = Agents.AddDefaulted_GetRef();
+	Agent.Component = Component;
+	Agent.TickInterval = Component->GetComponentTickInterval();
+
+	// spread first ticks evenly across the interval using the golden ratio
+	Agent.TimeUntilTick = Agent.TickInterval * FMath::Frac(StaggerCounter++ * 0.618034f);
+
+	Component->SubsystemTickIndex = Agents.Num() - 1;
+}
+
+void UUtilityAISubsystem::UnregisterComponent(UUtilityAIComponent* Component)
+{
+	if (!Component || !Agents.IsValidIndex(Component->SubsystemTickIndex))
+	{
+		return;
+	}
+
+	const int32 Idx = Component->SubsystemTickIndex;
+	check(Agents[Idx].Component == Component);
+
+	RemoveAgentAt(Idx);
+	Component->SubsystemTickIndex = INDEX_NONE;
+}
+
+void UUtilityAISubsystem::RemoveAgentAt(int32 Idx)
+{
+	Agents.RemoveAtSwap(Idx, 1, EAllowShrinking::No);
+	if (Agents.IsValidIndex(Idx) && Agents[Idx].Component)
+	{
+		Agents[Idx].Component->SubsystemTickIndex = Idx;
+	}
+}
+
+void UUtilityAISubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const float BudgetMs = CVarDecisionBudgetMs.GetValueOnGameThread();
+	const float MaxStaleness = CVarMaxDecisionStaleness.GetValueOnGameThread();
+	const bool bIsBudgeted = BudgetMs > 0.f;
+
+	const int64 TotalDeferred = SchedulerStats.TotalDeferred;
+	SchedulerStats = FUtilityAISchedulerStats();
+	SchedulerStats.TotalDeferred = TotalDeferred;
+
+	// advance time and gather all agents that are due to decide
+	DueAgents.Reset();
+	for (int32 Idx = 0; Idx < Agents.Num(); ++Idx)
+	{
+		FUtilityAIAgentTickInfo& Agent = Agents[Idx];
+		if (!Agent.Component)
+		{
+			// destroyed without unregistering
+			RemoveAgentAt(Idx);
+			--Idx;
+			continue;
+		}
+
+		Agent.TimeUntilTick -= DeltaTime;
+		Agent.TimeSinceTick += DeltaTime;
+		Agent.TimeSinceDecision += DeltaTime;
+		SchedulerStats.MaxStaleness = FMath::Max(SchedulerStats.MaxStaleness, Agent.TimeSinceDecision);
+
+		if (Agent.TimeUntilTick <= 0.f)
+		{
+			FDueAgent& DueAgent = DueAgents.AddDefaulted_GetRef();
+			DueAgent.Component = Agent.Component;
+			DueAgent.bIsOverdue = Agent.TimeSinceDecision >= MaxStaleness;
+		}
+	}
+	SchedulerStats.NumDue = DueAgents.Num();
+
+	if (bIsBudgeted && DueAgents.Num() > 1)
+	{
+		UpdateViewLocations();
+		for (FDueAgent& DueAgent : DueAgents)
+		{
+			DueAgent.Priority = CalculatePriority(Agents[DueAgent.Component->SubsystemTickIndex], MaxStaleness);
+		}
+
+		// overdue agents first, since they decide regardless of budget
+		DueAgents.Sort([](const FDueAgent& A, const FDueAgent& B)
+		{
+			if (A.bIsOverdue != B.bIsOverdue)
+			{
+				return A.bIsOverdue;
+			}
+			return A.Priority > B.Priority;
+		});
+	}
+
+	if (CVarParallelScoring.GetValueOnGameThread())
+	{
+		TickDueAgentsParallel(bIsBudgeted, BudgetMs);
+	}
+	else
+	{
+		TickDueAgents(bIsBudgeted, BudgetMs);
+	}
+
+	SchedulerStats.TotalDeferred += SchedulerStats.NumDeferred;
+}
+
+void UUtilityAISubsystem::TickDueAgents(bool bIsBudgeted, float BudgetMs)
+{
+	// only decisions count against the budget, ticking the current actions can't be deferred anyway
+	float DecisionsMs = 0.f;
+	for (const FDueAgent& DueAgent : DueAgents)
+	{
+		UUtilityAIComponent* Component = DueAgent.Component;
+		if (!Agents.IsValidIndex(Component->SubsystemTickIndex))
+		{
+			// unregistered by another agent's decision
+			continue;
+		}
+
+		FUtilityAIAgentTickInfo& Agent = Agents[Component->SubsystemTickIndex];
+		const float AgentDeltaTime = Agent.TimeSinceTick;
+		Agent.TimeSinceTick = 0.f;
+
+		const bool bIsWithinBudget = !bIsBudgeted || DecisionsMs < BudgetMs;
+		if (bIsWithinBudget || DueAgent.bIsOverdue)
+		{
+			// schedule the next decision, without trying to catch up on missed ones
+			Agent.TimeUntilTick = FMath::Max(Agent.TimeUntilTick + Agent.TickInterval, 0.f);
+			Agent.TimeSinceDecision = 0.f;
+
+			++SchedulerStats.NumEvaluated;
+			if (!bIsWithinBudget)
+			{
+				++SchedulerStats.NumForced;
+			}
+
+			// note that Agent may be invalid after this, if any components register or unregister
+			const double DecisionStartTime = FPlatformTime::Seconds();
+			Component->UpdateCurrentAction();
+			const float DecisionMs = static_cast<float>((FPlatformTime::Seconds() - DecisionStartTime) * 1000.0);
+			DecisionsMs += DecisionMs;
+
+			if (Agents.IsValidIndex(Component->SubsystemTickIndex))
+			{
+				UpdateAverageDecisionMs(Agents[Component->SubsystemTickIndex], DecisionMs);
+			}
+		}
+		else
+		{
+			// keep running the current action, and decide on a later frame
+			++SchedulerStats.NumDeferred;
+		}
+
+		if (Component->SubsystemTickIndex != INDEX_NONE)
+		{
+			Component->TickCurrentAction(AgentDeltaTime);
+		}
+	}
+
+	SchedulerStats.DecisionTimeMs = DecisionsMs;
+}
+
+void UUtilityAISubsystem::TickDueAgentsParallel(bool bIsBudgeted, float BudgetMs)
+{
+	// decide which agents fit in the budget up front, using their average decision times
+	DecidingAgents.Reset();
+	PendingScores.Reset();
+	float EstimatedMs = 0.f;
+	for (const FDueAgent& DueAgent : DueAgents)
+	{
+		FUtilityAIAgentTickInfo& Agent = Agents[DueAgent.Component->SubsystemTickIndex];
+		const bool bIsWithinBudget = !bIsBudgeted || EstimatedMs < BudgetMs;
+		if (bIsWithinBudget || DueAgent.bIsOverdue)
+		{
+			Agent.TimeUntilTick = FMath::Max(Agent.TimeUntilTick + Agent.TickInterval, 0.f);
+			Agent.TimeSinceDecision = 0.f;
+			EstimatedMs += Agent.AverageDecisionMs;
+
+			++SchedulerStats.NumEvaluated;
+			if (!bIsWithinBudget)
+			{
+				++SchedulerStats.NumForced;
+			}
+
+			DecidingAgents.Add(DueAgent.Component);
+		}
+		else
+		{
+			++SchedulerStats.NumDeferred;
+		}
+	}
+
+	// capture snapshots and score actions that must run on the game thread
+	const double PrepareStartTime = FPlatformTime::Seconds();
+	for (UUtilityAIComponent* Component : DecidingAgents)
+	{
+		if (Component->bAsyncScoring)
+		{
+			// already scoring in the background, and selecting from the previous frame's results
+			Component->UpdateCurrentAction();
+		}
+		else
+		{
+			Component->PrepareParallelScoring(PendingScores);
+		}
+	}
+
+	ParallelFor(TEXT("UtilityAI.ParallelScoring"), PendingScores.Num(), 16, [this](int32 Idx)
+	{
+		const FUtilityAIPendingScore& PendingScore = PendingScores[Idx];
+		PendingScore.Component->CalculateAndStoreActionScore(PendingScore.ActionIndex, 0.f, PendingScore.bIsDebugOnly);
+	});
+
+	for (UUtilityAIComponent* Component : DecidingAgents)
+	{
+		// note that components may be unregistered by another agent's decision
+		if (Component->SubsystemTickIndex != INDEX_NONE && !Component->bAsyncScoring)
+		{
+			Component->FinishParallelScoring();
+		}
+	}
+
+	SchedulerStats.DecisionTimeMs = static_cast<float>((FPlatformTime::Seconds() - PrepareStartTime) * 1000.0);
+
+	// split the total time evenly, since the time spent by each agent isn't measured individually
+	if (!DecidingAgents.IsEmpty())
+	{
+		const float DecisionMs = SchedulerStats.DecisionTimeMs / DecidingAgents.Num();
+		for (UUtilityAIComponent* Component : DecidingAgents)
+		{
+			if (Agents.IsValidIndex(Component->SubsystemTickIndex))
+			{
+				UpdateAverageDecisionMs(Agents[Component->SubsystemTickIndex], DecisionMs);
+			}
+		}
+	}
+
+	for (const FDueAgent& DueAgent : DueAgents)
+	{
+		UUtilityAIComponent* Component = DueAgent.Component;
+		if (Agents.IsValidIndex(Component->SubsystemTickIndex))
+		{
+			FUtilityAIAgentTickInfo& Agent = Agents[Component->SubsystemTickIndex];
+			const float AgentDeltaTime = Agent.TimeSinceTick;
+			Agent.TimeSinceTick = 0.f;
+			Component->TickCurrentAction(AgentDeltaTime);
+		}
+	}
+}
+
+void UUtilityAISubsystem::UpdateAverageDecisionMs(FUtilityAIAgentTickInfo& Agent, float DecisionMs)
+{
+	Agent.AverageDecisionMs = Agent.AverageDecisionMs > 0.f
+		                          ? FMath::Lerp(Agent.AverageDecisionMs, DecisionMs, 0.1f)
+		                          : DecisionMs;
+}
+
+void UUtilityAISubsystem::UpdateViewLocations()
+{
+	ViewLocations.Reset();
+
+	// includes all players on a server, and only local players on clients
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+}
+
+float UUtilityAISubsystem::CalculatePriority(const FUtilityAIAgentTickInfo& Agent, float MaxStaleness) const
+{
+	float DistanceFactor = 0.f;
+	const AAIController* AIController = Agent.Component->GetAIController();
+	if (const APawn* Pawn = AIController ? AIController->GetPawn() : nullptr)
+	{
+		const FVector PawnLocation = Pawn->GetActorLocation();
+		float MinDistSq = TNumericLimits<float>::Max();
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			MinDistSq = FMath::Min(MinDistSq, static_cast<float>(FVector::DistSquared(PawnLocation, ViewLocation)));
+		}
+
+		const float PriorityDistance = CVarPriorityDistance.GetValueOnGameThread();
+		if (!ViewLocations.IsEmpty() && PriorityDistance > 0.f)
+		{
+			DistanceFactor = 1.f - FMath::Clamp(FMath::Sqrt(MinDistSq) / PriorityDistance, 0.f, 1.f);
+		}
+	}
+
+	const float CombatFactor = Agent.Component->IsInCombat() ? 1.f : 0.f;
+	const float StalenessFactor = MaxStaleness > 0.f ? FMath::Clamp(Agent.TimeSinceDecision / MaxStaleness, 0.f, 1.f) : 1.f;
+
+	return DistanceFactor * CVarPriorityDistanceWeight.GetValueOnGameThread() +
+		CombatFactor * CVarPriorityCombatWeight.GetValueOnGameThread() +
+		StalenessFactor * CVarPriorityStalenessWeight.GetValueOnGameThread();
+}
+
+TStatId UUtilityAISubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UUtilityAISubsystem, STATGROUP_Tickables);
+}
@@ -2,3 +2,46 @@
 
 
 #include "UtilityAITypes.h"
+
+
+FUtilityAIScoreCombiner::FUtilityAIScoreCombiner(EUtilityAIScoreOperation InOperation, float InScoreWeight, float ScoreToBeat)
+	: Operation(InOperation),
+	  ScoreWeight(InScoreWeight),
+	  MinScore(FMath::Max(ScoreToBeat, UE_SMALL_NUMBER)),
+	  bCanStopEarly(ScoreToBeat >= 0.f),
+	  Result(InOperation == EUtilityAIScoreOperation::Max ? 0.f : 1.f)
+{
+}
+
+bool FUtilityAIScoreCombiner::Add(float ElementScore)
+{
+	bHasResult = true;
+
+	// element scores are 0..1, so a multiplied or min result can only decrease, and a max result can only increase
+	bool bIsResultKnown = false;
+	switch (Operation)
+	{
+	case EUtilityAIScoreOperation::Multiply:
+		Result *= ElementScore;
+		bIsResultKnown = Result * ScoreWeight <= MinScore;
+		break;
+
+	case EUtilityAIScoreOperation::Max:
+		Result = FMath::Max(Result, ElementScore);
+		bIsResultKnown = Result >= 1.f;
+		break;
+
+	case EUtilityAIScoreOperation::Min:
+		Result = FMath::Min(Result, ElementScore);
+		bIsResultKnown = Result * ScoreWeight <= MinScore;
+		break;
+	}
+
+	if (bIsResultKnown && bCanStopEarly)
+	{
+		// the partial result is only an upper bound, it can't beat the threshold so don't report it as a score
+		bStoppedEarly = Operation != EUtilityAIScoreOperation::Max;
+		return true;
+	}
+	return false;
+}
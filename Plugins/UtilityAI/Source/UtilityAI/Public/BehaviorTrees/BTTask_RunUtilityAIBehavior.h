@@ -0,0 +1,27 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/Tasks/BTTask_RunBehaviorDynamic.h"
+#include "BTTask_RunUtilityAIBehavior.generated.h"
+
+
+/**
+ * Run the behavior injected by a UtilityAIBehaviorAction into a persistent behavior tree.
+ * Works like Run Behavior Dynamic, but also picks up behaviors injected before the tree started,
+ * and notifies the UtilityAIBehaviorTreeComponent when the behavior finishes so single run actions can finish.
+ */
+UCLASS()
+class UTILITYAI_API UBTTask_RunUtilityAIBehavior : public UBTTask_RunBehaviorDynamic
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_RunUtilityAIBehavior(const FObjectInitializer& ObjectInitializer);
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+
+protected:
+	virtual void OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult) override;
+};
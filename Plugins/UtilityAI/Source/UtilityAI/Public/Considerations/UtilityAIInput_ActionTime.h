@@ -0,0 +1,35 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIInput_ActionTime.generated.h"
+
+
+/** The action event to measure time from. */
+UENUM(BlueprintType)
+enum class EUtilityAIActionTimeSource : uint8
+{
+	/** Time since the action was last executed. */
+	SinceExecuted,
+	/** Time since the action last finished. */
+	SinceFinished,
+};
+
+
+/**
+ * Input that returns the time in seconds since the action was last executed or finished.
+ */
+UCLASS(meta = (DisplayName = "Action Time"))
+class UTILITYAI_API UUtilityAIInput_ActionTime : public UUtilityAIConsiderationInput
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = "Input")
+	EUtilityAIActionTimeSource Source = EUtilityAIActionTimeSource::SinceFinished;
+
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const override;
+	virtual bool IsThreadSafe() const override { return true; }
+};
@@ -0,0 +1,32 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIInput_BlackboardDistance.generated.h"
+
+
+/**
+ * Input that returns the distance from the AI pawn to an actor or location stored in the blackboard.
+ */
+UCLASS(meta = (DisplayName = "Blackboard Distance"))
+class UTILITYAI_API UUtilityAIInput_BlackboardDistance : public UUtilityAIConsiderationInput
+{
+	GENERATED_BODY()
+
+public:
+	/** The name of the blackboard key containing the target actor or location. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	FName KeyName;
+
+	/** If true, ignore the vertical distance. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	bool bIgnoreZ = false;
+
+	/** The value to return when the target is not set. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	float DefaultDistance = UE_BIG_NUMBER;
+
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const override;
+};
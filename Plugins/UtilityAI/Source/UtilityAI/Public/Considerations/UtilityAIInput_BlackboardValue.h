@@ -0,0 +1,25 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIInput_BlackboardValue.generated.h"
+
+
+/**
+ * Input that reads a blackboard value from the AIController's blackboard.
+ * Float, int, enum and bool keys return their value, object and class keys return 1 when set.
+ */
+UCLASS(meta = (DisplayName = "Blackboard Value"))
+class UTILITYAI_API UUtilityAIInput_BlackboardValue : public UUtilityAIConsiderationInput
+{
+	GENERATED_BODY()
+
+public:
+	/** The name of the blackboard key to read. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	FName KeyName;
+
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const override;
+};
@@ -0,0 +1,31 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIInput_OwnerTags.generated.h"
+
+
+/**
+ * Input that returns 1 if the AIController has the given tags, otherwise 0.
+ * Useful as a cheap gate before more expensive considerations.
+ */
+UCLASS(meta = (DisplayName = "Owner Tags"))
+class UTILITYAI_API UUtilityAIInput_OwnerTags : public UUtilityAIConsiderationInput
+{
+	GENERATED_BODY()
+
+public:
+	/** The tags to check for. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	FGameplayTagContainer Tags;
+
+	/** If true, all tags must be present, otherwise any tag is enough. */
+	UPROPERTY(EditAnywhere, Category = "Input")
+	bool bRequireAll = false;
+
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const override;
+	virtual bool IsThreadSafe() const override { return true; }
+};
@@ -9,8 +9,13 @@
 #include "UObject/Object.h"
 #include "UtilityAIAction.generated.h"
 
+class AActor;
 class AAIController;
 class UUtilityAIComponent;
+class UUtilityAIConsideration;
+struct FUtilityAIActionDefinition;
+struct FUtilityAIConsiderationContext;
+struct FUtilityAIScoringSnapshot;
 
 
 /**
@@ -47,11 +52,25 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action")
 	EUtilityAIScoringMethod ScoringMethod = EUtilityAIScoringMethod::Function;
 
-	/** The AIController must have all of these tags for this action to be executed */
+	/** The considerations that are combined to calculate the score when using the Data scoring method. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action", meta = (EditCondition = "ScoringMethod == EUtilityAIScoringMethod::Data", EditConditionHides))
+	TArray<TObjectPtr<UUtilityAIConsideration>> Considerations;
+
+	/** The operation used to combine consideration scores when using the Data scoring method. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action", meta = (EditCondition = "ScoringMethod == EUtilityAIScoringMethod::Data", EditConditionHides))
+	EUtilityAIScoreOperation ConsiderationOperation = EUtilityAIScoreOperation::Multiply;
+
+	/**
+	 * The AIController must have all of these tags for this action to be executed.
+	 * Compiled when the action is added, call RecompileTags on the component after changing them at runtime.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action")
 	FGameplayTagContainer RequireTags;
 
-	/** The AIController must have none of these tags for this action to be executed */
+	/**
+	 * The AIController must have none of these tags for this action to be executed.
+	 * Compiled when the action is added, call RecompileTags on the component after changing them at runtime.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action")
 	FGameplayTagContainer IgnoreTags;
 
@@ -59,37 +78,103 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Action")
 	FGameplayTagQuery TagQuery;
 
+	/**
+	 * If true, only recalculate the score when one of its dependencies has changed, or MarkScoreDirty is called,
+	 * and reuse the last score otherwise. Changes to RequireTags and IgnoreTags are always dependencies.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Invalidation")
+	bool bScoreOnlyWhenDirty = false;
+
+	/** Recalculate the score when any matching tag is added to or removed from the AIController. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Invalidation", meta = (EditCondition = "bScoreOnlyWhenDirty"))
+	FGameplayTagContainer DependencyTags;
+
+	/** Recalculate the score when any of these blackboard keys are set using UtilityAIBehaviorStatics. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Invalidation", meta = (EditCondition = "bScoreOnlyWhenDirty"))
+	TArray<FName> DependencyBlackboardKeys;
+
+	/** Recalculate the score when the AIController's perception is updated. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Invalidation", meta = (EditCondition = "bScoreOnlyWhenDirty"))
+	bool bDependsOnPerception = false;
+
+	/**
+	 * The max time in seconds a score can be reused before it's recalculated anyway.
+	 * Required for scores that depend on time. 0 allows reusing the score forever.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Invalidation", meta = (EditCondition = "bScoreOnlyWhenDirty", ClampMin = 0))
+	float MaxScoreAge = 1.f;
+
 protected:
-	/** The current score for this action. */
-	UPROPERTY(Transient, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
-	float Score = 0.f;
+	/** Information shared by all instances of this action's class. Set when initialized. */
+	mutable const FUtilityAIActionDefinition* Definition = nullptr;
 
-	/** Is the score locked at its current value? Useful to prevent scores from dropping while active. */
-	UPROPERTY(Transient, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
-	bool bIsScoreFrozen = false;
+	/** Element scores from CalculateElementScores_BP, reused between calculations. */
+	TArray<FUtilityAIScore> BlueprintElementScores;
+
+	/** The index of this action in the component's action list. */
+	int32 ActionIndex = INDEX_NONE;
+
+	/** The runtime state of this action when it isn't owned by a UtilityAIComponent. */
+	FUtilityAIActionState DetachedState;
+
+	friend class UUtilityAIComponent;
+	friend struct FUtilityAIActionDefinition;
 
 	/** Detailed information about the last known score calculated for this action. */
 	UPROPERTY(Transient, BlueprintReadOnly)
 	FUtilityAIScoringElements ScoringElements;
 
+	/** Deprecated, use GetScore. Copied from the action's state, which is stored by the component. */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (AllowPrivateAccess = "true", DeprecatedProperty, DeprecationMessage = "Use GetScore instead."))
+	float Score = 0.f;
+
+	/** Deprecated, use IsScoreFrozen. Copied from the action's state, which is stored by the component. */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (AllowPrivateAccess = "true", DeprecatedProperty, DeprecationMessage = "Use IsScoreFrozen instead."))
+	bool bIsScoreFrozen = false;
+
+	/** Copy the action's state to the deprecated properties, so that existing Blueprints keep reading current values. */
+	void UpdateDeprecatedProperties();
+
 public:
+	/** Deprecated, use GetExecuteCount. Copied from the action's state, which is stored by the component. */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (DeprecatedProperty, DeprecationMessage = "Use GetExecuteCount instead."))
+	int32 ExecuteCount = 0;
+
+	/** Deprecated, use GetLastExecuteTime. Copied from the action's state, which is stored by the component. */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (DeprecatedProperty, DeprecationMessage = "Use GetLastExecuteTime instead."))
+	float LastExecuteTime = -1000.f;
+
+	/** Deprecated, use GetLastFinishTime. Copied from the action's state, which is stored by the component. */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (DeprecatedProperty, DeprecationMessage = "Use GetLastFinishTime instead."))
+	float LastFinishTime = -1000.f;
+
+	/** Return the information shared by all instances of this action's class. */
+	const FUtilityAIActionDefinition& GetDefinition() const;
+
+	/** Return the runtime state of this action, stored by the owning component, or by this action if it has none. */
+	const FUtilityAIActionState& GetState() const;
+
+	/** Return the runtime state of this action, stored by the owning component, or by this action if it has none. */
+	FUtilityAIActionState& GetMutableState();
+
 	/** Return the current score for this action. */
-	FORCEINLINE float GetScore() const { return Score; }
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	float GetScore() const { return GetState().Score; }
 
 	/** Return the current score elements for this action. */
 	FORCEINLINE const FUtilityAIScoringElements& GetScoringElements() const { return ScoringElements; }
 
-	/** The number of times this action has been executed. */
-	UPROPERTY(Transient, BlueprintReadOnly)
-	int32 ExecuteCount = 0;
+	/** Return the number of times this action has been executed. */
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	int32 GetExecuteCount() const { return GetState().ExecuteCount; }
 
 	/** If > 0, the time at which this action was last executed. */
-	UPROPERTY(Transient, BlueprintReadOnly)
-	float LastExecuteTime = -1000;
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	float GetLastExecuteTime() const { return GetState().LastExecuteTime; }
 
 	/** If > 0, the time at which this action was last finished. */
-	UPROPERTY(Transient, BlueprintReadOnly)
-	float LastFinishTime = -1000;
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	float GetLastFinishTime() const { return GetState().LastFinishTime; }
 
 	/** Return the UtilityAIComponent that owns this action */
 	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
@@ -105,39 +190,99 @@ public:
 
 	virtual UWorld* GetWorld() const override;
 
+	/** Return the world state captured for the current decision, if any. */
+	const FUtilityAIScoringSnapshot* GetScoringSnapshot() const;
+
 	/** Return true if this action is currently allowed to calculate its score */
 	virtual bool CanCalculateScore() const;
 
 	/**
-	 * Calculate and store the score for this action.
-	 * Access the score afterward with `GetScore`.
+	 * Calculate and store the score for this action, if it needs to be updated.
+	 * Access the score afterward with `GetScore`. Returns true if the score was calculated.
+	 * @param ScoreToBeat The score that must be exceeded for this action to be selected. When scoring considerations,
+	 *		evaluation stops as soon as the score can no longer exceed it, leaving an upper bound as the score.
+	 *		Negative values disable stopping early.
+	 */
+	bool UpdateScore(float ScoreToBeat = 0.f);
+
+	/** Recalculate the score on the next update, when using bScoreOnlyWhenDirty. */
+	UFUNCTION(BlueprintCallable, Category = "AI|UtilityAI")
+	void MarkScoreDirty() { GetMutableState().bIsScoreDirty = true; }
+
+	/** Return true if the score depends on any of these AIController tags, either through its requirements or DependencyTags. */
+	bool DependsOnTags(const FGameplayTagContainer& Tags) const;
+
+	/**
+	 * Return true if scoring this action reads the component's scoring snapshot, either from considerations,
+	 * to match compiled tag requirements, or to track tag changes for bScoreOnlyWhenDirty.
 	 */
-	void UpdateScore();
+	bool ReadsScoringSnapshot() const;
+
+	/**
+	 * Return true if this action's score can be calculated from worker threads.
+	 * Blueprint scoring is never thread-safe, data scoring is thread-safe when all considerations are,
+	 * and native custom scoring is thread-safe when the class default sets bIsCustomScoringThreadSafe.
+	 */
+	bool IsScoringThreadSafe() const;
 
 	/** Calculate the score for this action given the current context */
-	float CalculateScore();
+	float CalculateScore(float ScoreToBeat = -1.f);
+
+	/**
+	 * Calculate the score for this action given the current context, storing scoring elements in OutElements.
+	 * If InState is set, considerations read it instead of the action's live state.
+	 */
+	float CalculateScore(float ScoreToBeat, FUtilityAIScoringElements& OutElements, const FUtilityAIActionState* InState = nullptr);
+
+	/**
+	 * Calculate the score of this action by evaluating and combining its considerations, before applying InScoreWeight.
+	 * Considerations are evaluated cheapest first, stopping once the result is known, or once
+	 * the weighted result can no longer exceed ScoreToBeat, in which case 0 is returned.
+	 * Const so that agents without an instance can score the class default object with their own state and weight.
+	 */
+	float CalculateDataScore(const FUtilityAIConsiderationContext& Context, float InScoreWeight, float ScoreToBeat,
+	                         FUtilityAIScoringElements& OutElements) const;
+
+	/** Return true if Considerations are the class default's, so they can be evaluated in the order sorted by the definition. */
+	bool HasDefaultConsiderations() const;
 
-	/** Calculate the score of this action using data driven parameters */
-	float CalculateDataScore();
+	/**
+	 * Perform a custom calculation of the current score, adding any scoring elements to OutElements.
+	 * Calls the blueprint scoring events if implemented, otherwise CalculateCustomScore.
+	 */
+	virtual float CalculateCustomScoreElements(FUtilityAIScoringElements& OutElements);
 
 	/** Perform a custom calculation to determine the current score of this action */
 	virtual float CalculateCustomScore();
 
 	/** Calculate a score from a set of scores. */
-	virtual float CombineScores(const TArray<float>& InScores, EUtilityAIScoreOperation Operation);
+	virtual float CombineScores(TConstArrayView<float> InScores, EUtilityAIScoreOperation Operation);
 
 	/** Return true if this action is currently allowed to be executed */
 	virtual bool CanExecute() const;
 
-	/** Return true if the AIController matches this action's tag requirements. */
+	/**
+	 * Return true if the AIController matches this action's tag requirements.
+	 * Uses the tags from the component's scoring snapshot when it was captured this frame, and caches the result
+	 * until the next frame or until the tags change. Otherwise the AIController's current tags are checked.
+	 */
 	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
 	virtual bool AreTagRequirementsMet() const;
 
+	/** Return true if RequireTags, IgnoreTags or TagQuery are set. */
+	bool HasTagRequirements() const { return !RequireTags.IsEmpty() || !IgnoreTags.IsEmpty() || !TagQuery.IsEmpty(); }
+
+	/** Return true if a set of tags matches this action's tag requirements. */
+	bool MatchesTagRequirements(const FGameplayTagContainer& Tags) const;
+
+	/** Return true if an actor's current tags match this action's tag requirements. False if it has no tags. */
+	bool MatchesTagRequirements(const AActor* Actor) const;
+
 	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
-	bool IsExecuting() const { return bIsExecuting; }
+	bool IsExecuting() const { return GetState().bIsExecuting; }
 
 	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
-	bool IsAborting() const { return bIsAborting; }
+	bool IsAborting() const { return GetState().bIsAborting; }
 
 	/** Initialize the action. Called once when the action instance is created. */
 	virtual void Initialize();
@@ -157,7 +302,10 @@ public:
 	/** Abort the action if it is currently active. Must call FinishAction eventually */
 	virtual void Abort();
 
-	/** Tick the action while it is executing */
+	/**
+	 * Tick the action while it is executing.
+	 * Only called for classes that implement Tick in Blueprint or derive from a native subclass.
+	 */
 	virtual void Tick(float DeltaTime);
 
 	/**
@@ -167,7 +315,7 @@ public:
 	virtual bool IsBusy() const { return false; }
 
 	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
-	virtual bool IsScoreFrozen() const { return bIsScoreFrozen || (bFreezeScoreWhenActive && IsExecuting()); }
+	virtual bool IsScoreFrozen() const { return GetState().bIsScoreFrozen || (bFreezeScoreWhenActive && IsExecuting()); }
 
 	/** Freeze the current score so it doesn't update. */
 	UFUNCTION(BlueprintCallable, Category = "AI|UtilityAI")
@@ -217,24 +365,26 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, meta = (DisplayName = "OnFinished", ScriptName = "OnFinished"))
 	void OnFinished_BP();
 
-protected:
-	bool bHasBlueprintInitialize;
-	bool bHasBlueprintDeinitialize;
-	bool bHasBlueprintCalculateElementScores;
-	bool bHasBlueprintCalculateScore;
-	bool bHasBlueprintExecute;
-	bool bHasBlueprintAbort;
-	bool bHasBlueprintOnFinished;
+	/** Tick the action while it is executing */
+	UFUNCTION(BlueprintImplementableEvent, meta = (DisplayName = "Tick", ScriptName = "Tick"))
+	void Tick_BP(float DeltaTime);
 
+protected:
 	/** Is the action initialized? */
 	UPROPERTY(Transient)
 	bool bIsInitialized;
 
-	/** Is the action currently being executed? */
-	UPROPERTY(Transient)
-	bool bIsExecuting;
+	/**
+	 * Set from native constructors to declare that CalculateCustomScore only reads the scoring snapshot
+	 * and this action's own state, allowing it to be called from worker threads.
+	 * Read from the class default object when the action's definition is created.
+	 */
+	bool bIsCustomScoringThreadSafe = false;
 
-	/** Is the action currently being aborted? */
-	UPROPERTY(Transient)
-	bool bIsAborting;
+	/**
+	 * Set from native constructors to declare that this class doesn't override any scoring, tag or state functions,
+	 * so that agents can score it from the class default object and only create an instance once it's selected.
+	 * Only used with the Data scoring method. Read from the class default object when the action's definition is created.
+	 */
+	bool bCanScoreFromClassDefault = false;
 };
@@ -0,0 +1,86 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UUtilityAIAction;
+class UUtilityAIConsideration;
+
+
+/**
+ * Information about an action class that is the same for every agent, such as which Blueprint
+ * events are implemented. Created once per class, and shared by all agents. Agents without an
+ * instance of the action score it using the class default object and this definition.
+ */
+struct UTILITYAI_API FUtilityAIActionDefinition
+{
+	bool bHasBlueprintInitialize = false;
+	bool bHasBlueprintDeinitialize = false;
+	bool bHasBlueprintCalculateElementScores = false;
+	bool bHasBlueprintCalculateScore = false;
+	bool bHasBlueprintExecute = false;
+	bool bHasBlueprintAbort = false;
+	bool bHasBlueprintOnFinished = false;
+	bool bHasBlueprintTick = false;
+
+	/**
+	 * Does a native class between UUtilityAIAction and this class exist that may override Tick?
+	 * Native overrides can't be detected directly, so any native subclass is assumed to tick.
+	 */
+	bool bHasNativeTick = false;
+
+	/** Is native custom scoring thread-safe, and not overridden by Blueprint scoring events? */
+	bool bIsCustomScoringThreadSafe = false;
+
+	/**
+	 * Can agents score this action from the class default object, and only create an instance once it's selected?
+	 * Requires the Data scoring method, no Blueprint Initialize, Deinitialize or scoring events, and native classes
+	 * other than UUtilityAIAction must set bCanScoreFromClassDefault.
+	 */
+	bool bCanScoreFromClassDefault = false;
+
+	/** The class default object. */
+	const UUtilityAIAction* DefaultAction = nullptr;
+
+	/** The class name, used to name trace events. */
+	FString TraceName;
+
+	/** The class default's considerations, used to tell whether an instance has changed them. */
+	TArray<const UUtilityAIConsideration*> Considerations;
+
+	/** Are all of the class default's considerations thread-safe? */
+	bool bAreConsiderationsThreadSafe = false;
+
+	/**
+	 * Indices of valid considerations, in the order they should be evaluated.
+	 * Only re-sorted on the game thread while ai.Utility.MeasureConsiderationCost is enabled.
+	 */
+	mutable TArray<int32> ConsiderationOrder;
+
+	/** The measured average cost of each consideration, in cycles. Only updated on the game thread when measuring is enabled. */
+	mutable TArray<float> MeasuredConsiderationCosts;
+
+	/** The number of data score calculations since considerations were last sorted. */
+	mutable int32 NumCalculationsSinceSort = 0;
+
+	/** Update ConsiderationOrder using declared costs, or measured costs once every consideration has been measured. */
+	void SortConsiderationsByCost(bool bUseMeasuredCost) const;
+
+	/** Does the action need to be ticked while executing? */
+	bool NeedsTick() const { return bHasBlueprintTick || bHasNativeTick; }
+
+	/** Return the definition for an action class, creating it if needed. */
+	static const FUtilityAIActionDefinition& Get(const UClass* ActionClass);
+
+	/**
+	 * Rebuild all existing definitions, e.g. after Blueprints have been recompiled.
+	 * Definitions are updated in place, so that pointers held by action instances remain valid.
+	 */
+	static void RefreshAll();
+
+private:
+	explicit FUtilityAIActionDefinition(const UClass* ActionClass);
+
+	void Update(const UClass* ActionClass);
+};
@@ -3,12 +3,38 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
 #include "Engine/DataAsset.h"
 #include "UtilityAIActionSet.generated.h"
 
 class UUtilityAIAction;
 
 
+/**
+ * An action from an action set, compiled when the set is saved so agents can be created without
+ * iterating the Actions map or compiling tags for each action.
+ */
+USTRUCT()
+struct FUtilityAICompiledAction
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TSubclassOf<UUtilityAIAction> ActionClass;
+
+	UPROPERTY()
+	float ScoreWeight = 1.f;
+
+	/** The action's RequireTags, as indices into the set's CompiledTags. */
+	UPROPERTY()
+	TArray<uint8> RequireTagIndices;
+
+	/** The action's IgnoreTags, as indices into the set's CompiledTags. */
+	UPROPERTY()
+	TArray<uint8> IgnoreTagIndices;
+};
+
+
 /**
  * A collection of actions and their relative score weighting.
  */
@@ -26,7 +52,54 @@ public:
 	UFUNCTION(BlueprintCallable, CallInEditor, Category = "Actions")
 	void SortByWeight();
 
+	/** Return the compiled actions, in the same order as the Actions map. */
+	const TArray<FUtilityAICompiledAction>& GetCompiledActions() const { return CompiledActions; }
+
+	/**
+	 * Return true if the compiled actions match the classes and weights of the Actions map, in order,
+	 * i.e. it hasn't been changed at runtime.
+	 */
+	bool AreCompiledActionsUpToDate() const;
+
+	/** Return the unique tags used by the compiled actions' requirements. */
+	const TArray<FGameplayTag>& GetCompiledTags() const { return CompiledTags; }
+
+	/**
+	 * Return true if the compiled tag requirements and dependencies can be used.
+	 * Always false in editor builds, since action defaults can change without resaving the set.
+	 */
+	bool CanUseCompiledTags() const;
+
+	/** Return all tags that any action's score depends on, see UUtilityAIAction::DependsOnTags. */
+	const FGameplayTagContainer& GetCompiledDependencyTags() const { return CompiledDependencyTags; }
+
+	/** Return true if any action has a tag query, and so depends on all tags. Also true if any tags couldn't be compiled. */
+	bool HasTagQueries() const { return bHasTagQueries; }
+
+	/** Rebuild the compiled actions from the Actions map. */
+	void Compile();
+
+	virtual void PostLoad() override;
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
+
+protected:
+	UPROPERTY()
+	TArray<FUtilityAICompiledAction> CompiledActions;
+
+	UPROPERTY()
+	TArray<FGameplayTag> CompiledTags;
+
+	UPROPERTY()
+	FGameplayTagContainer CompiledDependencyTags;
+
+	/** Were all tags compiled? False if there are too many unique tags. */
+	UPROPERTY()
+	bool bHasCompiledTags = false;
+
+	UPROPERTY()
+	bool bHasTagQueries = false;
 };
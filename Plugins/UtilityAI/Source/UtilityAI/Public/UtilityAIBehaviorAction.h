@@ -3,18 +3,22 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
 #include "UtilityAIAction.h"
 #include "BehaviorTree/BehaviorTreeTypes.h"
 #include "BehaviorTree/BlackboardAssetProvider.h"
 #include "UtilityAIBehaviorAction.generated.h"
 
 class UBehaviorTree;
-class UBehaviorTreeComponent;
 class UBlackboardData;
+class UUtilityAIBehaviorTreeComponent;
 
 
 /**
- * A Utility AI action that runs a behavior tree when executed. 
+ * A Utility AI action that runs a behavior tree when executed.
+ * The tree is run by a UtilityAIBehaviorTreeComponent, which replaces the AIController's brain component
+ * if it's any other kind, so that the action is notified as soon as the tree stops. Trees stopped or replaced
+ * by calling StopTree or StartTree on the component directly are detected on the action's next tick instead.
  */
 UCLASS(Abstract)
 class UTILITYAI_API UUtilityAIBehaviorAction : public UUtilityAIAction,
@@ -38,6 +42,18 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	bool bFinishWhenBehaviorStops = false;
 
+	/**
+	 * An optional behavior tree that keeps running between actions. When set, behaviors are injected into its
+	 * Run Utility AI Behavior node matching BehaviorInjectTag instead of being started as the root tree,
+	 * reusing the blackboard and the tree's instance memory. Injected behaviors must use a compatible blackboard.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UBehaviorTree> PersistentBehaviorAsset;
+
+	/** The injection tag of the node in the persistent behavior that runs this action's behaviors. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "PersistentBehaviorAsset != nullptr"))
+	FGameplayTag BehaviorInjectTag;
+
 	/** The blackboard key in which to store a reference to this utility action */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FBlackboardKeySelector UtilityActionKey;
@@ -48,6 +64,13 @@ public:
 	/** Initialize blackboard keys for a behavior tree asset */
 	virtual void InitBlackboardKeys();
 
+	/** Resolve UtilityActionKey for a blackboard asset, if it wasn't already resolved for it. */
+	void ResolveUtilityActionKey(const UBlackboardData& BlackboardAsset);
+
+	/** Return true if behaviors are injected into the persistent behavior, instead of being started as the root tree. */
+	UFUNCTION(BlueprintPure)
+	bool UsesPersistentBehavior() const;
+
 	/** Run the action's behavior tree on the owning AI Controller */
 	UFUNCTION(BlueprintCallable)
 	bool RunBehaviorTree(UBehaviorTree* BehaviorTree, bool bSingleRun = false);
@@ -61,26 +84,50 @@ public:
 	bool RunDefaultBehaviorTree();
 
 	/**
-	 * Called when the behavior tree started by this action has finished.
-	 * Only called when using SingleRun = True with RunBehaviorTree.
+	 * Called on the frame the behavior tree started by this action finishes, or its logic is stopped by something else.
+	 * Trees stopped or replaced with StopTree or StartTree by other code are noticed on the next tick instead.
+	 * Only called for trees that stop on their own when using SingleRun = True with RunBehaviorTree.
+	 * When using a persistent behavior, called when the injected behavior finishes, or the persistent behavior stops.
 	 */
 	UFUNCTION(BlueprintNativeEvent)
 	void OnBehaviorTreeFinished();
 
 	virtual void Initialize() override;
+	virtual void Deinitialize() override;
 	virtual void Execute() override;
 	virtual void Abort() override;
 	virtual void Tick(float DeltaTime) override;
 
 protected:
 	/** Weak reference to the behavior tree component, set after running a behavior. */
-	TWeakObjectPtr<UBehaviorTreeComponent> BTComp;
+	TWeakObjectPtr<UUtilityAIBehaviorTreeComponent> BTComp;
 
 	/** The current or last behavior being run by this action */
 	TWeakObjectPtr<UBehaviorTree> CurrentBehavior;
 
+	/** The root tree running the current behavior, either the behavior itself or the persistent behavior. */
+	TWeakObjectPtr<UBehaviorTree> CurrentRootBehavior;
+
 	bool bIsBehaviorRunning = false;
 
+	/** Was the current behavior run with SingleRun = True? */
+	bool bIsSingleRunBehavior = false;
+
+	/** The blackboard asset that UtilityActionKey was last resolved for. */
+	TWeakObjectPtr<const UBlackboardData> UtilityActionKeyBlackboard;
+
+	/** Called when the behavior tree component stops a tree. */
+	void OnBehaviorTreeStopped(UUtilityAIBehaviorTreeComponent* InBTComp, UBehaviorTree* BehaviorTree);
+
+	/** Called when a behavior injected into the persistent behavior finishes. */
+	void OnInjectedBehaviorFinished(UUtilityAIBehaviorTreeComponent* InBTComp, FGameplayTag InjectTag, UBehaviorTree* BehaviorTree);
+
+	/** Stop listening for the behavior tree component to stop. */
+	void UnbindBehaviorTreeEvents();
+
+	/** Return true if the action replacing this one will inject its behavior into the same persistent behavior node. */
+	bool IsNextActionInjectingBehavior() const;
+
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
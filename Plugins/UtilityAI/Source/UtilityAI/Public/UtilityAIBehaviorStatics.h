@@ -95,4 +95,8 @@ public:
 	/** Resets indicated value to "not set" value, based on values type */
 	UFUNCTION(BlueprintCallable, Meta = (HidePin = "ActionOwner", DefaultToSelf = "ActionOwner"), Category = "AI|UtilityAI")
 	static void ClearBlackboardValue(UUtilityAIAction* ActionOwner, const FBlackboardKeySelector& Key);
+
+protected:
+	/** Mark the scores of actions that depend on a blackboard key as dirty. */
+	static void NotifyBlackboardValueChanged(UUtilityAIAction* ActionOwner, const FBlackboardKeySelector& Key);
 };
@@ -0,0 +1,85 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "UObject/ObjectKey.h"
+#include "UtilityAIBehaviorTreeComponent.generated.h"
+
+class AAIController;
+class UBehaviorTree;
+class UBlackboardComponent;
+class UBlackboardData;
+class UUtilityAIBehaviorTreeComponent;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FUtilityAIBehaviorTreeStoppedDelegate, UUtilityAIBehaviorTreeComponent* /*BTComp*/, UBehaviorTree* /*BehaviorTree*/);
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FUtilityAIInjectedBehaviorFinishedDelegate, UUtilityAIBehaviorTreeComponent* /*BTComp*/, FGameplayTag /*InjectTag*/, UBehaviorTree* /*BehaviorTree*/);
+
+
+/**
+ * A behavior tree component that notifies listeners when its tree stops, either because it finished
+ * running in single run mode, or because its logic was stopped. Used by UtilityAIBehaviorActions
+ * to finish on the same frame as their behavior, instead of polling it.
+ * StopTree and StartTree aren't virtual, so trees stopped or replaced by calling them directly aren't broadcast.
+ *
+ * Also keeps track of behaviors injected into a persistent tree, which are run by Run Utility AI Behavior nodes.
+ */
+UCLASS(ClassGroup = AI)
+class UTILITYAI_API UUtilityAIBehaviorTreeComponent : public UBehaviorTreeComponent
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIBehaviorTreeComponent(const FObjectInitializer& ObjectInitializer);
+
+	/**
+	 * Return the AIController's UtilityAIBehaviorTreeComponent, creating it and assigning it as the brain if needed.
+	 * Any other brain component is stopped, destroyed and replaced with a warning, since only this component
+	 * can notify when its tree stops. Give AIControllers a UtilityAIBehaviorTreeComponent brain to avoid this.
+	 */
+	static UUtilityAIBehaviorTreeComponent* FindOrCreate(AAIController& AIController);
+
+	/** Called when the root tree stops running. */
+	FUtilityAIBehaviorTreeStoppedDelegate OnTreeStopped;
+
+	/** Called when a behavior run by a Run Utility AI Behavior node finishes without being aborted. */
+	FUtilityAIInjectedBehaviorFinishedDelegate OnInjectedBehaviorFinished;
+
+	/**
+	 * Inject a behavior into the Run Utility AI Behavior (or Run Behavior Dynamic) nodes matching a tag,
+	 * restarting the tree if they were found. The blackboard and the tree's instance memory are kept.
+	 * Pass a null behavior to clear the nodes.
+	 * @param bUpdateRunningTree If false, the behavior is only used the next time a Run Utility AI Behavior node executes.
+	 */
+	void InjectBehavior(FGameplayTag InjectTag, UBehaviorTree* BehaviorAsset, bool bUpdateRunningTree = true);
+
+	/** Find the behavior last injected for a tag. Returns false if nothing was injected. */
+	bool FindInjectedBehavior(FGameplayTag InjectTag, UBehaviorTree*& OutBehaviorAsset) const;
+
+	/** Called by Run Utility AI Behavior nodes when their behavior finishes. */
+	void NotifyInjectedBehaviorFinished(FGameplayTag InjectTag, UBehaviorTree* BehaviorAsset);
+
+	/**
+	 * Return true if a blackboard component's asset is compatible with a tree's blackboard asset.
+	 * Results are cached for the lifetime of this component.
+	 */
+	bool IsBlackboardCompatible(const UBlackboardComponent& BlackboardComp, const UBlackboardData* BlackboardAsset);
+
+	virtual void StopLogic(const FString& Reason) override;
+	virtual void Cleanup() override;
+
+protected:
+	virtual void OnTreeFinished() override;
+
+	/** Notify listeners that a tree stopped, if it was running. */
+	void BroadcastTreeStopped(UBehaviorTree* BehaviorTree, bool bWasRunning);
+
+	/** The behaviors injected for each tag, applied when a Run Utility AI Behavior node is executed. */
+	UPROPERTY(Transient)
+	TMap<FGameplayTag, TObjectPtr<UBehaviorTree>> InjectedBehaviors;
+
+	/** Cached results of IsBlackboardCompatible, by the blackboard component's asset and the tested asset. */
+	TMap<TPair<TObjectKey<UBlackboardData>, TObjectKey<UBlackboardData>>, bool> BlackboardCompatibility;
+};
@@ -6,9 +6,68 @@
 
 #include "UtilityAIAction.h"
 #include "Components/ActorComponent.h"
+#include "Tasks/Task.h"
 #include "UtilityAIComponent.generated.h"
 
 class UUtilityAIActionSet;
+class UUtilityAIComponent;
+class UUtilityAISubsystem;
+struct FUtilityAIActionDefinition;
+struct FUtilityAICompiledAction;
+struct FUtilityAIScoringSnapshot;
+
+
+/** An action whose score will be calculated on a worker thread. */
+struct FUtilityAIPendingScore
+{
+	UUtilityAIComponent* Component = nullptr;
+	int32 ActionIndex = INDEX_NONE;
+	bool bIsDebugOnly = false;
+
+	/** A copy of the action's state when the score was queued, so worker threads never read the live state. */
+	FUtilityAIActionState State;
+
+	/** The calculated score, when scoring asynchronously, until it's committed on the game thread. */
+	float Score = 0.f;
+
+	/** The scoring elements for Score. */
+	FUtilityAIScoringElements Elements;
+};
+
+
+/**
+ * The per-agent data of an action that isn't part of its runtime state. Actions without an instance are
+ * scored from their class default object using this data, so most of it would otherwise live on the instance.
+ */
+struct FUtilityAIActionSlot
+{
+	/** Information shared by every agent with this action. */
+	const FUtilityAIActionDefinition* Definition = nullptr;
+
+	/** The score weight from the action set, used until the action has an instance. */
+	float ScoreWeight = 1.f;
+
+	/** RequireTags compiled against the component's tag table. */
+	FUtilityAITagBits RequireTagBits;
+
+	/** IgnoreTags compiled against the component's tag table. */
+	FUtilityAITagBits IgnoreTagBits;
+
+	/** Were RequireTags and IgnoreTags compiled? False if the component's tag table is full. */
+	bool bHasCompiledTagRequirements = false;
+
+	/** The last result of matching uncompiled tag requirements. */
+	mutable bool bCachedTagRequirementsMet = false;
+
+	/** The component's owner tags serial when bCachedTagRequirementsMet was calculated. */
+	mutable uint32 TagRequirementsSerial = 0;
+
+	/** The frame when bCachedTagRequirementsMet was calculated. */
+	mutable uint64 TagRequirementsFrame = MAX_uint64;
+
+	/** Detailed information about the last score, until the action has an instance which stores it instead. */
+	FUtilityAIScoringElements ScoringElements;
+};
 
 
 /**
@@ -23,10 +82,17 @@ class UTILITYAI_API UUtilityAIComponent : public UActorComponent
 public:
 	UUtilityAIComponent();
 
-	/** If any of these tags are present, the AI is considered busy and cannot change actions. */
+	/**
+	 * If any of these tags are present, the AI is considered busy and cannot change actions.
+	 * Compiled when activated, call RecompileTags after changing them at runtime.
+	 */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FGameplayTagContainer BusyTags;
 
+	/** If any of these tags are present, the AI is considered in combat, and its decisions are prioritized when over budget. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FGameplayTagContainer CombatTags;
+
 	/**
 	 * Actions must be higher than this threshold above the current action in order to be selected.
 	 * Note that if multiple actions have the same max score, they will not be able to replace each
@@ -35,6 +101,30 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
 	float ScoreHysteresisThreshold = 0.02f;
 
+	/**
+	 * How actions are visited and scored when selecting the next action.
+	 * BranchAndBound skips actions whose ScoreWeight can't beat the best score, which is much cheaper for large action sets.
+	 * Ignored when scoring in parallel or with bAsyncScoring, since the best score isn't known until every action is
+	 * scored. Those paths always score like Exhaustive, and only stop each action early once it can't be selected.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EUtilityAISelectionMode SelectionMode = EUtilityAISelectionMode::Exhaustive;
+
+	/**
+	 * If true, this component is ticked in batches by the UtilityAISubsystem instead of using its own tick function.
+	 * The component tick interval is still respected, and components are staggered across frames.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bUseSubsystemTick = false;
+
+	/**
+	 * If true, actions with thread-safe scoring are scored in the background against a snapshot captured
+	 * when the decision starts, and the best action is selected on the next update.
+	 * This delays decisions by one update, but keeps scoring off the game thread.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bAsyncScoring = false;
+
 	UFUNCTION(BlueprintPure)
 	AAIController* GetAIController() const;
 
@@ -54,6 +144,17 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent)
 	void AddActionsFromSet(const UUtilityAIActionSet* ActionSet);
 
+	/** Deinitialize and remove an action by class, aborting it first if it is the current action. */
+	UFUNCTION(BlueprintCallable)
+	void RemoveAction(TSubclassOf<UUtilityAIAction> ActionClass);
+
+	/** Remove all actions that are in an action set. */
+	UFUNCTION(BlueprintCallable)
+	void RemoveActionsFromSet(const UUtilityAIActionSet* ActionSet);
+
+	/** Reserve space for a number of additional actions, to avoid reallocating while adding them. */
+	void ReserveActions(int32 NumNewActions);
+
 	/**
 	 * Deinitialize and destroy all action instances.
 	 * Usually called at the same time brain logic would stop, such as on unpossess.
@@ -65,44 +166,396 @@ public:
 	UFUNCTION(BlueprintPure)
 	bool HasAction(TSubclassOf<UUtilityAIAction> ActionClass) const;
 
-	/** Return an action by class */
+	/** Return an action by class, creating its instance if it's currently scored from its class default object. */
 	UFUNCTION(BlueprintCallable, BlueprintPure = false)
-	UUtilityAIAction* GetAction(TSubclassOf<UUtilityAIAction> ActionClass) const;
+	UUtilityAIAction* GetAction(TSubclassOf<UUtilityAIAction> ActionClass);
 
-	/** Return all action instances. */
+	/**
+	 * Return the instance of every action. Actions that can be scored from their class default object
+	 * have no instance until they're first selected, or returned by GetAction, and are null here.
+	 */
 	const TArray<UUtilityAIAction*>& GetAllActions() const { return Actions; }
 
+	/** Return the runtime state of all actions, indexed the same as GetAllActions. */
+	const TArray<FUtilityAIActionState>& GetAllActionStates() const { return ActionStates; }
+
+	/** Return the number of actions, including those without an instance. */
+	int32 GetNumActions() const { return ActionSlots.Num(); }
+
+	/** Return the class of an action. */
+	const UClass* GetActionClass(int32 ActionIdx) const;
+
+	/** Return the instance of an action, or its class default object if it has no instance. Use to read its properties. */
+	const UUtilityAIAction& GetActionOrDefault(int32 ActionIdx) const;
+
+	/** Return the instance of an action, creating it if needed. Returns null for INDEX_NONE. */
+	UUtilityAIAction* GetOrCreateActionInstance(int32 ActionIdx);
+
+	/** Return the weight that an action's score is multiplied by. */
+	float GetActionScoreWeight(int32 ActionIdx) const;
+
+	/** Return detailed information about the last score calculated for an action. */
+	const FUtilityAIScoringElements& GetActionScoringElements(int32 ActionIdx) const;
+
+	/** Return true if the AIController matches an action's tag requirements. See UUtilityAIAction::AreTagRequirementsMet. */
+	bool AreActionTagRequirementsMet(int32 ActionIdx) const;
+
 	UFUNCTION(BlueprintCallable)
 	void AbortCurrentAction();
 
+	/**
+	 * Return the action that is about to replace the current action, while the current action is being aborted.
+	 * Lets aborted actions leave shared state for the next action instead of resetting it.
+	 */
+	UUtilityAIAction* GetNextAction() const { return NextAction; }
+
+	/** Return information about the work done while selecting actions. */
+	UFUNCTION(BlueprintPure)
+	FUtilityAISelectionStats GetSelectionStats() const { return SelectionStats; }
+
 	/** Return true if the owner or current action is busy. If true, the AI is unable to change actions. */
 	UFUNCTION(BlueprintPure)
 	virtual bool IsBusy() const;
 
+	/** If true, actions store the names of their scoring elements. Enabled by the gameplay debugger for the debugged agent. */
+	bool bCaptureScoreNames = false;
+
+	/** If true, and ai.Utility.DebugCalculateScores is 2, every action is fully scored for debugging, even if it can't execute. */
+	UPROPERTY(Transient, BlueprintReadWrite)
+	bool bDebugCalculateScores = false;
+
+	/** Return true if actions should be fully scored for debugging when ai.Utility.DebugCalculateScores is 2. */
+	bool ShouldDebugCalculateScores() const { return bDebugCalculateScores || bCaptureScoreNames; }
+
+	/** Return true if the owner is in combat. Used to prioritize decisions when the UtilityAISubsystem is over budget. */
+	UFUNCTION(BlueprintPure)
+	virtual bool IsInCombat() const;
+
+	/** Return the world state captured for the current decision, if any. */
+	const FUtilityAIScoringSnapshot* GetScoringSnapshot() const { return ScoringSnapshot.Get(); }
+
+	/** Return true if the scoring snapshot was captured this frame, so its tags are still current. */
+	bool IsScoringSnapshotCurrent() const { return ScoringSnapshot && OwnerTagBitsFrame == GFrameCounter; }
+
+	/** Return a number that changes whenever the AIController tags in the scoring snapshot change. */
+	uint32 GetOwnerTagsSerial() const { return OwnerTagsSerial; }
+
+	/** Return the AIController tags from the scoring snapshot as bits of this component's tag table. */
+	const FUtilityAITagBits& GetOwnerTagBits() const { return OwnerTagBits; }
+
+	/**
+	 * Rebuild the matrix of which actions can interrupt each other while busy.
+	 * Happens automatically when actions are added, but must be called after changing
+	 * OwnedTags or InterruptActionsWithTags of any action at runtime.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void UpdateInterruptMatrix();
+
+	/**
+	 * Rebuild the tag table from BusyTags and the tag requirements of every action.
+	 * Happens automatically when activated, but must be called after changing BusyTags,
+	 * or the RequireTags or IgnoreTags of any action at runtime.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RecompileTags();
+
+	/** Wait for any background scoring to complete, and discard the results. */
+	void CancelAsyncScoring();
+
+	/** Mark the scores of all actions that depend on a blackboard key as dirty. */
+	UFUNCTION(BlueprintCallable)
+	void NotifyBlackboardKeyChanged(FName KeyName);
+
+	/** Recalculate the scores of all actions on the next update. */
+	UFUNCTION(BlueprintCallable)
+	void MarkAllScoresDirty();
+
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Activate(bool bReset = false) override;
 	virtual void Deactivate() override;
 
 protected:
-	/** The instances of every action currently available */
+	/** The instance of every action currently available, or null for actions scored from their class default object. */
 	UPROPERTY(Transient)
 	TArray<TObjectPtr<UUtilityAIAction>> Actions;
 
+	/** The runtime state of each action, indexed the same as Actions. */
+	UPROPERTY(Transient)
+	TArray<FUtilityAIActionState> ActionStates;
+
+	/** The definition, weight and compiled tags of each action, indexed the same as Actions. */
+	TArray<FUtilityAIActionSlot> ActionSlots;
+
+	/** The index of each action in Actions, by class. */
+	TMap<const UClass*, int32> ActionIndicesByClass;
+
+	friend UUtilityAIAction;
+
 	/** The current action being executed */
 	UPROPERTY(Transient)
 	TObjectPtr<UUtilityAIAction> CurrentAction;
 
-	/** Create a new action instance. If ScoreWeight is > 0, override the action's default score weight. */
-	UUtilityAIAction* CreateActionInstance(TSubclassOf<UUtilityAIAction> ActionClass, float ScoreWeight = -1.f);
+	/** The action being activated while the current action is aborted. */
+	TObjectPtr<UUtilityAIAction> NextAction;
+
+	/** Indices into Actions, sorted by descending ScoreWeight. Used by the BranchAndBound selection mode. */
+	TArray<int32> ActionsByWeight;
+
+	/** Information about the work done while selecting actions. */
+	UPROPERTY(Transient)
+	FUtilityAISelectionStats SelectionStats;
+
+	/**
+	 * The world state captured at the start of each decision. Only captured when NeedsScoringSnapshot returns true,
+	 * or when actions are scored on worker threads.
+	 */
+	TSharedPtr<FUtilityAIScoringSnapshot> ScoringSnapshot;
+
+	/** Does scoring any action read the scoring snapshot? Only grows while actions are added. */
+	bool bAnyActionReadsScoringSnapshot = false;
+
+	/**
+	 * Return true if the scoring snapshot must be captured for decisions made on the game thread.
+	 * Override when custom scoring reads inputs added by a snapshot subclass.
+	 */
+	virtual bool NeedsScoringSnapshot() const;
+
+	/** Create the snapshot used by this component. Override to use a snapshot subclass with additional inputs. */
+	virtual TSharedRef<FUtilityAIScoringSnapshot> CreateScoringSnapshot() const;
+
+	/** Fill in the scoring snapshot from the current world state. */
+	virtual void CaptureScoringSnapshot(FUtilityAIScoringSnapshot& Snapshot) const;
+
+	/** Create the scoring snapshot if needed, and capture the current world state. */
+	void UpdateScoringSnapshot();
+
+	/** The AIController tags when the scoring snapshot was last captured. */
+	FGameplayTagContainer LastOwnerTags;
+
+	/** Tags added or removed since the last snapshot, reused between updates. */
+	FGameplayTagContainer ChangedOwnerTags;
+
+	/** Incremented whenever the AIController tags change. */
+	uint32 OwnerTagsSerial = 0;
+
+	/**
+	 * Every tag that any action's score depends on. Only grows while actions are added,
+	 * so that tag changes which can't affect any action don't need to check each one.
+	 */
+	FGameplayTagContainer ActionDependencyTags;
+
+	/** Does any action depend on all tags, e.g. because of a tag query? */
+	bool bAnyActionDependsOnAllTags = false;
+
+	/** Every tag used by the tag requirements of actions, or BusyTags. The index of each tag is its bit in FUtilityAITagBits. */
+	TArray<FGameplayTag> TagTable;
+
+	/** The AIController tags from the scoring snapshot, as bits of TagTable. Includes parent tags. */
+	FUtilityAITagBits OwnerTagBits;
+
+	/** BusyTags as bits of TagTable. */
+	FUtilityAITagBits BusyTagBits;
+
+	/** Were BusyTags compiled? False if the tag table is full. */
+	bool bHasCompiledBusyTags = false;
+
+	/** The frame when OwnerTagBits were last updated. */
+	uint64 OwnerTagBitsFrame = MAX_uint64;
+
+	/**
+	 * For each pair of actions, can the first action be interrupted by the second while busy?
+	 * Indexed by CurrentActionIndex * Actions.Num() + NewActionIndex.
+	 */
+	TBitArray<> InterruptMatrix;
+
+	/** Add tags to the tag table, and set their bits in OutBits. Returns false if the table is full. */
+	bool CompileTags(const FGameplayTagContainer& Tags, FUtilityAITagBits& OutBits);
+
+	/** Compile the tag requirements of an action. */
+	void CompileTagRequirements(int32 ActionIdx);
+
+	/**
+	 * Return true if the AIController matches an action's tag requirements, using its compiled tags or cached result.
+	 * Implements UUtilityAIAction::AreTagRequirementsMet, without calling it for instances that override it.
+	 */
+	bool CheckTagRequirements(int32 ActionIdx) const;
+
+	/** Update OwnerTagBits from the tags in the scoring snapshot. */
+	void UpdateOwnerTagBits();
+
+	/** Mark the scores of actions that depend on any AIController tags that changed since the last snapshot as dirty. */
+	void UpdateOwnerTagDependencies();
+
+	UFUNCTION()
+	void OnPerceptionUpdated(const TArray<AActor*>& UpdatedActors);
+
+	/** Start or stop listening for perception updates. */
+	void BindPerceptionEvents(bool bBind);
+
+	/** The background task scoring AsyncPendingScores. */
+	UE::Tasks::FTask AsyncScoringTask;
+
+	/** Actions being scored in the background. */
+	TArray<FUtilityAIPendingScore> AsyncPendingScores;
+
+	/** Has a decision been started that will be completed on the next update? */
+	bool bIsAsyncDecisionPending = false;
+
+	/** Complete the decision started on the previous update, then start a new one. */
+	void UpdateCurrentActionAsync();
+
+	/**
+	 * Add a new action, returning its index. If ScoreWeight is > 0, override the action's default score weight.
+	 * If CompiledAction is set, its tag requirements are used instead of compiling the action's tags,
+	 * with CompiledTagIndices mapping the action set's compiled tags to the tag table.
+	 * An instance is only created if the action can't be scored from its class default object.
+	 */
+	int32 CreateAction(TSubclassOf<UUtilityAIAction> ActionClass, float ScoreWeight = -1.f,
+	                   const FUtilityAICompiledAction* CompiledAction = nullptr,
+	                   TConstArrayView<int32> CompiledTagIndices = {});
+
+	/** Create and initialize the instance of an action that doesn't have one yet. */
+	UUtilityAIAction* CreateActionInstance(int32 ActionIdx);
+
+	/** Add tags to the tag table, returning false if it is full. OutIndices contains the index of each tag. */
+	bool CompileTagTable(TConstArrayView<FGameplayTag> Tags, TArray<int32>& OutIndices);
+
+	/** Add an action's tag dependencies to ActionDependencyTags. */
+	void AddActionTagDependencies(const UUtilityAIAction& Action);
+
+	/** Deinitialize and remove an action, and its instance if it has one. */
+	void DestroyAction(int32 ActionIdx);
+
+	/** Select an action to perform, returning its index, or INDEX_NONE. */
+	int32 SelectAction();
+
+	/** Score every action in order and return the best one. */
+	int32 SelectActionExhaustive();
+
+	/** Score actions by descending weight, stopping once no remaining action can beat the best one. */
+	int32 SelectActionBranchAndBound();
 
-	/** Select an action to perform */
-	UUtilityAIAction* SelectAction();
+	/** Update the score of an action, and replace BestActionIdx with it if it scores higher. */
+	void ScoreAndCompareAction(int32 ActionIdx, int32& BestActionIdx);
+
+	/** Return the score another action must exceed to replace the best action. */
+	float GetScoreToBeat(int32 BestActionIdx) const;
+
+	/** Update ActionsByWeight, re-sorting only if actions or weights have changed. */
+	void UpdateActionsByWeight();
+
+	/** Return the best action using the scores already calculated, without scoring any actions. */
+	int32 SelectBestScoredAction() const;
+
+	/**
+	 * Calculate and store the score of an action, if it needs to be updated. Returns true if the score was calculated.
+	 * See UUtilityAIAction::UpdateScore.
+	 */
+	bool UpdateActionScore(int32 ActionIdx, float ScoreToBeat);
+
+	/**
+	 * Return true if an action's score should be calculated right now, and clear its dirty state. Must be called on the game thread.
+	 * bOutIsDebugOnly is set when the score is only being calculated for debugging, and should not be stored.
+	 */
+	bool ShouldUpdateActionScore(int32 ActionIdx, bool& bOutIsDebugOnly);
+
+	/**
+	 * Calculate and store the score of an action, once ShouldUpdateActionScore has returned true.
+	 * Can be called from worker threads if IsActionScoringThreadSafe returns true.
+	 */
+	void CalculateAndStoreActionScore(int32 ActionIdx, float ScoreToBeat, bool bIsDebugOnly);
+
+	/** Calculate the score of an action using its instance, or its class default object and this agent's state. */
+	float CalculateActionScore(int32 ActionIdx, float ScoreToBeat, const FUtilityAIActionState& State,
+	                           FUtilityAIScoringElements& OutElements);
+
+	/**
+	 * Calculate a score in the background, without changing the action's current score or scoring elements.
+	 * Must be followed by CommitPendingScore on the game thread.
+	 */
+	void CalculatePendingScore(FUtilityAIPendingScore& PendingScore);
+
+	/** Make a score calculated by CalculatePendingScore the action's current score. */
+	void CommitPendingScore(FUtilityAIPendingScore& PendingScore);
+
+	/**
+	 * Discard the current score of an action because it was skipped without being scored, so it can't be selected
+	 * with an outdated score. Frozen scores are kept.
+	 */
+	void ClearActionScore(int32 ActionIdx);
+
+	/** Return true if an action is currently allowed to calculate its score. */
+	bool CanCalculateActionScore(int32 ActionIdx) const;
+
+	/** Return true if an action's score needs to be recalculated. Always true unless using bScoreOnlyWhenDirty. */
+	bool IsActionScoreDirty(int32 ActionIdx) const;
+
+	/** Return true if an action's score can be calculated from worker threads. */
+	bool IsActionScoringThreadSafe(int32 ActionIdx) const;
+
+	/** Return true if an action is currently allowed to be executed. */
+	bool CanExecuteAction(int32 ActionIdx) const;
+
+	/** Return the scoring elements that an action's next score should be stored in. */
+	FUtilityAIScoringElements& GetMutableActionScoringElements(int32 ActionIdx);
+
+	/** Copy the state of an action to its instance's deprecated properties, if it has an instance. */
+	void UpdateDeprecatedActionProperties(int32 ActionIdx);
+
+	/** Return true if scoring element names should be stored, for debugging. */
+	bool ShouldCaptureScoreNames() const;
+
+	/**
+	 * Return true if every element of every score should be calculated for debugging, even when actions can't execute.
+	 * Only true for agents selected by ai.Utility.DebugCalculateScores.
+	 */
+	bool IsDebugCalculatingScores() const;
+
+	/** Activate an action if it's allowed to replace the current action. */
+	void TryActivateAction(UUtilityAIAction* NewAction);
+
+	/**
+	 * Activate an action by index if it's allowed to replace the current action,
+	 * only creating its instance once it is.
+	 */
+	void TryActivateAction(int32 ActionIdx);
 
 	/** Return true if a new action can be started immediately. */
 	virtual bool CanActivateAction(UUtilityAIAction* NewAction);
 
+	/** Return true if an action is allowed to replace the current action, using the interrupt matrix. */
+	bool IsActivationAllowed(int32 ActionIdx);
+
 	void OnCurrentActionFinished();
 
+	/** The index of this component in the UtilityAISubsystem, if it's being ticked by it. */
+	int32 SubsystemTickIndex = INDEX_NONE;
+
+	friend UUtilityAISubsystem;
+
+	/** Return the UtilityAISubsystem for this component's world. */
+	UUtilityAISubsystem* GetUtilityAISubsystem() const;
+
 public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Select and activate the best action, then tick the current action. */
+	void TickActions(float DeltaTime);
+
+	/** Select the best action, and activate it if it's allowed to replace the current action. */
+	void UpdateCurrentAction();
+
+	/** Tick the current action, if any. */
+	void TickCurrentAction(float DeltaTime);
+
+	/**
+	 * Begin selecting an action with parallel scoring. Captures the scoring snapshot and scores all actions
+	 * that aren't thread-safe, then adds the remaining actions to OutPendingScores to be scored on worker threads.
+	 * Call FinishParallelScoring once they have all been scored.
+	 * SelectionMode is ignored, every action is scored against a score to beat of 0.
+	 */
+	void PrepareParallelScoring(TArray<FUtilityAIPendingScore>& OutPendingScores);
+
+	/** Select and activate the best action after all pending scores have been calculated. */
+	void FinishParallelScoring();
 };
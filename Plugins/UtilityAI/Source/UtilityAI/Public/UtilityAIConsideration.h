@@ -0,0 +1,189 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Curves/CurveFloat.h"
+#include "Engine/DataAsset.h"
+#include "UObject/Object.h"
+#include "UtilityAIConsideration.generated.h"
+
+class AAIController;
+class UUtilityAIAction;
+class UUtilityAIComponent;
+struct FUtilityAIActionState;
+struct FUtilityAIScoringSnapshot;
+
+
+/**
+ * Context available to consideration inputs while scoring an action.
+ */
+struct FUtilityAIConsiderationContext
+{
+	FUtilityAIConsiderationContext(const UUtilityAIAction& InAction, const FUtilityAIScoringSnapshot* InSnapshot,
+	                               const FUtilityAIActionState* InActionState = nullptr,
+	                               const UUtilityAIComponent* InComponent = nullptr)
+		: Action(InAction),
+		  Snapshot(InSnapshot),
+		  ActionState(InActionState),
+		  Component(InComponent)
+	{
+	}
+
+	/** The action being scored. May be a class default object when agents don't have action instances. */
+	const UUtilityAIAction& Action;
+
+	/** The world state captured for this decision, if available. */
+	const FUtilityAIScoringSnapshot* Snapshot;
+
+	/**
+	 * The runtime state of the action, or a copy of it when scored in the background. Inputs should read this instead
+	 * of the action's state when set, since the live state may be changed by the game thread while they're evaluated.
+	 */
+	const FUtilityAIActionState* ActionState;
+
+	/** The component scoring the action, if Action is a class default object scored by a UtilityAIComponent. */
+	const UUtilityAIComponent* Component;
+
+	/** Return the AIController of the agent the action is being scored for, if any. */
+	AAIController* GetAIController() const;
+};
+
+
+/** The shape of a response curve used to map a consideration input to a score. */
+UENUM(BlueprintType)
+enum class EUtilityAIResponseCurveType : uint8
+{
+	/** Slope * (X - XShift) + YShift */
+	Linear,
+	/** Slope * (X - XShift) ^ Exponent + YShift */
+	Polynomial,
+	/** 1 / (1 + e ^ (-Slope * (X - XShift))) + YShift */
+	Logistic,
+	/** 1 when X >= XShift, otherwise 0. */
+	Step,
+	/** Evaluate a custom curve. */
+	Custom,
+};
+
+
+/**
+ * Maps a normalized 0..1 input value to a 0..1 score.
+ */
+USTRUCT(BlueprintType)
+struct UTILITYAI_API FUtilityAIResponseCurve
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EUtilityAIResponseCurveType Type = EUtilityAIResponseCurveType::Linear;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Type != EUtilityAIResponseCurveType::Step && Type != EUtilityAIResponseCurveType::Custom"))
+	float Slope = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Type == EUtilityAIResponseCurveType::Polynomial"))
+	float Exponent = 2.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Type != EUtilityAIResponseCurveType::Custom"))
+	float XShift = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Type != EUtilityAIResponseCurveType::Step && Type != EUtilityAIResponseCurveType::Custom"))
+	float YShift = 0.f;
+
+	/** The curve to evaluate when using the Custom type, sampled from 0..1. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Type == EUtilityAIResponseCurveType::Custom"))
+	FRuntimeFloatCurve CustomCurve;
+
+	/** If true, invert the result, so that 1 becomes 0 and vice versa. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bInvert = false;
+
+	/** Return the 0..1 response for a 0..1 input value. */
+	float Evaluate(float X) const;
+};
+
+
+/**
+ * Provides the raw input value for a consideration, e.g. a distance, a time, or a blackboard value.
+ */
+UCLASS(Abstract, EditInlineNew, DefaultToInstanced, CollapseCategories)
+class UTILITYAI_API UUtilityAIConsiderationInput : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Return the raw input value for the action being scored. */
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const PURE_VIRTUAL(UUtilityAIConsiderationInput::GetValue, return 0.f;);
+
+	/**
+	 * Return true if GetValue only reads the scoring snapshot and the action being scored,
+	 * allowing it to be called from worker threads.
+	 */
+	virtual bool IsThreadSafe() const { return false; }
+};
+
+
+/**
+ * A reusable scoring element for data driven actions.
+ * Reads an input value, normalizes it, and maps it through a response curve to produce a 0..1 score.
+ */
+UCLASS(BlueprintType)
+class UTILITYAI_API UUtilityAIConsideration : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** The name shown when debugging, uses the asset name if empty. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration")
+	FString DisplayName;
+
+	/** The source of the raw input value. */
+	UPROPERTY(EditAnywhere, Instanced, BlueprintReadOnly, Category = "Consideration")
+	TObjectPtr<UUtilityAIConsiderationInput> Input;
+
+	/** The input value that maps to 0. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration")
+	float InputMin = 0.f;
+
+	/** The input value that maps to 1. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration")
+	float InputMax = 1.f;
+
+	/** The curve used to convert the normalized input into a score. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration")
+	FUtilityAIResponseCurve ResponseCurve;
+
+	/** A multiplier applied to the response, the result is still clamped to 0..1. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration", meta = (ClampMin = 0))
+	float Weight = 1.f;
+
+	/**
+	 * The relative cost of evaluating this consideration.
+	 * Cheaper considerations are evaluated first, so that failing gates can skip more expensive checks.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Consideration", meta = (ClampMin = 0))
+	float Cost = 1.f;
+
+	/** Return the 0..1 score for this consideration. */
+	float Evaluate(const FUtilityAIConsiderationContext& Context) const;
+
+	/** Return true if this consideration can be evaluated from worker threads. */
+	bool IsThreadSafe() const { return Input && Input->IsThreadSafe(); }
+
+	/** Return the name to display when debugging this consideration. */
+	FName GetDisplayName() const { return CachedDisplayName; }
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+	/** Cached display name, to avoid building it while scoring. */
+	FName CachedDisplayName;
+
+	void UpdateCachedDisplayName();
+};
@@ -0,0 +1,177 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIDecisionTrace.h"
+#include "Containers/RingBuffer.h"
+#include "Tasks/Pipe.h"
+#include "UObject/ObjectKey.h"
+#include <atomic>
+
+class UUtilityAIAction;
+class UUtilityAIComponent;
+
+
+/** Where a decision recorder keeps its records. */
+enum class EUtilityAIDecisionRecorderMode : uint8
+{
+	/** Keep the most recent records in memory, to be saved on demand, e.g. when a bug is reported. */
+	RingBuffer,
+	/** Stream all records to a file. */
+	File,
+};
+
+
+/**
+ * Records every decision made by UtilityAIComponents to a compact binary trace, see FUtilityAIDecisionTraceFormat.
+ *
+ * Records are encoded into a block on the game thread, which is handed off to a background pipe
+ * at the end of each frame, or once it's full. The pipe either appends blocks to a file, or keeps them
+ * in a ring buffer of limited size. In either mode, memory is bounded: blocks are dropped if the file
+ * can't be written as fast as they are recorded.
+ *
+ * Each block defines the names and agents it uses, and includes each agent's tags in its first decision,
+ * so any block can be read without the ones before it, e.g. once they've been evicted from the ring buffer.
+ *
+ * Only one recorder is active at a time. Control it with the ai.Utility.*DecisionRecording console commands.
+ */
+class UTILITYAI_API FUtilityAIDecisionRecorder
+{
+public:
+	~FUtilityAIDecisionRecorder();
+
+	/** Return the active recorder, or null if decisions aren't being recorded. */
+	static FUtilityAIDecisionRecorder* Get() { return ActiveRecorder; }
+
+	/**
+	 * Start recording decisions, replacing any active recorder.
+	 * @param Mode Whether to keep recent records in memory, or stream them to Filename.
+	 * @param Filename The file to stream to when using the File mode.
+	 * @param MaxBytes The size of the ring buffer, or the max bytes waiting to be written to the file.
+	 */
+	static bool Start(EUtilityAIDecisionRecorderMode Mode, const FString& Filename, int64 MaxBytes);
+
+	/** Stop recording, finishing any pending writes. */
+	static void Stop();
+
+	/** Record a decision made by a component, after activating the selected action if allowed. */
+	void RecordDecision(const UUtilityAIComponent& Component, const UUtilityAIAction* SelectedAction,
+	                    const UUtilityAIAction* CurrentAction, EUtilityAIDecisionReason Reason);
+
+	/** Forget a component that is no longer making decisions. */
+	void RemoveAgent(const UUtilityAIComponent& Component);
+
+	/** Save the contents of the ring buffer to a file in the background. */
+	bool SaveRingBuffer(const FString& Filename);
+
+	EUtilityAIDecisionRecorderMode GetMode() const { return Mode; }
+
+	/** Return the number of blocks that were dropped because the file couldn't keep up. */
+	int32 GetNumDroppedBlocks() const { return NumDroppedBlocks.load(); }
+
+	/** Resolve a filename relative to the Saved/UtilityAI directory. */
+	static FString GetTraceFilename(const FString& Filename);
+
+private:
+	FUtilityAIDecisionRecorder(EUtilityAIDecisionRecorderMode InMode, TUniquePtr<FArchive> InFileWriter, int64 InMaxBytes);
+
+	static FUtilityAIDecisionRecorder* ActiveRecorder;
+
+	/** The state of a recorded agent. */
+	struct FAgent
+	{
+		uint32 Id = 0;
+
+		/** The name of the agent's owner. */
+		FName Name;
+
+		/** The block that the agent was last defined in. */
+		uint32 DefinedBlock = 0;
+
+		/** The block that the agent's tags were last recorded in. */
+		uint32 TagsBlock = 0;
+
+		/** The owner tags serial of the last recorded tags. */
+		uint32 TagsSerial = 0;
+
+		/** The world time of the last recorded decision. */
+		double LastRecordTime = -1.0;
+	};
+
+	/** The id of a recorded name. */
+	struct FNameEntry
+	{
+		uint32 Id = 0;
+
+		/** The block that the name was last defined in. */
+		uint32 DefinedBlock = 0;
+	};
+
+	EUtilityAIDecisionRecorderMode Mode;
+
+	int64 MaxBytes = 0;
+
+	/** Blocks are handed off to the pipe once they reach this size. */
+	int32 BlockSize = 64 * 1024;
+
+	/** Names are forgotten and their ids reused once this many have been defined. */
+	static constexpr int32 MaxNames = 16 * 1024;
+
+	/** Should scoring elements be recorded? */
+	bool bRecordElements = true;
+
+	// game thread state
+
+	TMap<TObjectKey<UUtilityAIComponent>, FAgent> Agents;
+
+	uint32 NextAgentId = 1;
+
+	/** The number of agents after destroyed components were last forgotten. */
+	int32 NumAgentsAfterPrune = 0;
+
+	TMap<FName, FNameEntry> NameIds;
+
+	uint32 NextNameId = 1;
+
+	/** The serial of the current block, incremented whenever a block is handed off. */
+	uint32 BlockSerial = 1;
+
+	/** The name and agent records used by the current block, written before its decision records. */
+	TArray<uint8> BlockDefinitions;
+
+	/** The decision records waiting to be handed off to the pipe. */
+	TArray<uint8> Block;
+
+	FDelegateHandle EndFrameHandle;
+
+	// background state, only accessed from the pipe
+
+	UE::Tasks::FPipe WriterPipe;
+
+	TUniquePtr<FArchive> FileWriter;
+
+	TRingBuffer<TArray<uint8>> RingBlocks;
+
+	int64 RingBytes = 0;
+
+	/** The bytes handed off to the pipe that haven't been written yet. */
+	std::atomic<int64> PendingBytes{0};
+
+	std::atomic<int32> NumDroppedBlocks{0};
+
+	/** Return the id of a name, defining it in the current block if needed. */
+	uint32 GetNameId(FName Name);
+
+	/** Return the state of an agent, defining it in the current block if needed. */
+	FAgent& FindOrAddAgent(const UUtilityAIComponent& Component);
+
+	/** Hand off the current block and its definitions to the pipe. */
+	void SubmitBlock();
+
+	/** Forget names and destroyed agents, so that long recordings don't grow without bound. */
+	void PruneDefinitions();
+
+	/** Write or store a block, on the pipe. */
+	void ConsumeBlock(TArray<uint8>&& Data);
+};
@@ -0,0 +1,148 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAITypes.h"
+
+
+/** Why the current action did or didn't change after a decision. */
+enum class EUtilityAIDecisionReason : uint8
+{
+	/** No action could be selected. */
+	None,
+	/** The current action was still the best action. */
+	Kept,
+	/** The best action was started while no action was running. */
+	Started,
+	/** The best action replaced the current action. */
+	Replaced,
+	/** The best action interrupted the current action while busy. */
+	Interrupted,
+	/** The best action couldn't replace the current action because the AI was busy. */
+	Blocked,
+};
+
+UTILITYAI_API const TCHAR* LexToString(EUtilityAIDecisionReason Reason);
+
+
+/**
+ * The binary format of decision traces written by FUtilityAIDecisionRecorder.
+ *
+ * A trace is a header (Magic, Version as little-endian uint32s) followed by records, each starting with a
+ * uint8 ERecordType. Integers are unsigned LEB128 varints, floats and doubles are little-endian IEEE.
+ *
+ * Name:     Id, Length, UTF-8 characters. Id 0 is always None.
+ * Agent:    AgentId, NameId of the AIController.
+ * Decision: AgentId, WorldTime (double), FrameNumber, Reason (uint8), SelectedActionNameId, CurrentActionNameId,
+ *           Flags (uint8 EDecisionFlags), [NumTags, TagNameId...], NumActions, then for each action:
+ *           ActionNameId, Score (float), Flags (uint8 EActionFlags),
+ *           [Operation (uint8), NumSkipped, NumElements, (ElementNameId, Score (float))...]
+ *
+ * Names and agents are always defined before the first decision that uses them. Records are written in blocks,
+ * each starting with the names and agents it uses, so ids may be redefined by later blocks.
+ */
+struct FUtilityAIDecisionTraceFormat
+{
+	static constexpr uint32 Magic = 0x44494155; // 'UAID'
+	static constexpr uint32 Version = 1;
+
+	enum class ERecordType : uint8
+	{
+		Name = 1,
+		Agent = 2,
+		Decision = 3,
+	};
+
+	enum EDecisionFlags : uint8
+	{
+		/** The AIController tags changed since the agent's last decision, or this is its first decision in a block, and are included. */
+		DF_HasTags = 1 << 0,
+	};
+
+	enum EActionFlags : uint8
+	{
+		/** The score was calculated since the agent's last decision. */
+		AF_Scored = 1 << 0,
+		/** The action was executing after the decision. */
+		AF_Executing = 1 << 1,
+		/** The scoring elements are included. */
+		AF_HasElements = 1 << 2,
+	};
+};
+
+
+/** A scoring element read from a decision trace. */
+struct FUtilityAIDecisionTraceElement
+{
+	FString Name;
+	float Score = 0.f;
+};
+
+
+/** An action's score read from a decision trace. */
+struct FUtilityAIDecisionTraceAction
+{
+	FString Name;
+	float Score = 0.f;
+	bool bScored = false;
+	bool bExecuting = false;
+	bool bHasElements = false;
+	EUtilityAIScoreOperation Operation = EUtilityAIScoreOperation::Multiply;
+	int32 NumSkipped = 0;
+	TArray<FUtilityAIDecisionTraceElement> Elements;
+};
+
+
+/** A single decision read from a decision trace. */
+struct FUtilityAIDecisionTraceRecord
+{
+	uint32 AgentId = 0;
+	FString AgentName;
+	double WorldTime = 0.0;
+	uint64 FrameNumber = 0;
+	EUtilityAIDecisionReason Reason = EUtilityAIDecisionReason::None;
+	FString SelectedAction;
+	FString CurrentAction;
+
+	/** Are Tags included? Tags are only recorded when they change or a new block starts, otherwise they're the same as the agent's last decision. */
+	bool bHasTags = false;
+	TArray<FString> Tags;
+
+	TArray<FUtilityAIDecisionTraceAction> Actions;
+};
+
+
+/**
+ * Reads decisions from a trace file written by FUtilityAIDecisionRecorder, one at a time.
+ */
+class UTILITYAI_API FUtilityAIDecisionTraceReader
+{
+public:
+	FUtilityAIDecisionTraceReader();
+	~FUtilityAIDecisionTraceReader();
+
+	/** Open a trace file and read its header. Returns false if it's not a valid trace. */
+	bool Open(const FString& Filename);
+
+	/** Read the next decision. Returns false at the end of the trace, or if it's truncated or invalid. */
+	bool ReadNext(FUtilityAIDecisionTraceRecord& OutRecord);
+
+	/** Return true if the trace was invalid, rather than just ending. */
+	bool HasError() const { return bHasError; }
+
+private:
+	TUniquePtr<FArchive> Archive;
+
+	TMap<uint32, FString> Names;
+
+	TMap<uint32, FString> AgentNames;
+
+	bool bHasError = false;
+
+	uint64 ReadVarInt();
+	float ReadFloat();
+	double ReadDouble();
+	const FString& ReadNameId();
+	bool ReadDecision(FUtilityAIDecisionTraceRecord& OutRecord);
+};
@@ -13,4 +13,10 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+#if WITH_EDITOR
+	FDelegateHandle ObjectsReplacedHandle;
+	FDelegateHandle ReloadCompleteHandle;
+#endif
 };
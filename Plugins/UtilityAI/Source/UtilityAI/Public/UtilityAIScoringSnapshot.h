@@ -0,0 +1,34 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+
+/**
+ * A copy of the world state needed to score an agent's actions, captured on the game thread before scoring.
+ * Thread-safe actions and consideration inputs read from this instead of live actors, so they can be scored on worker threads.
+ *
+ * Projects can add their own inputs by subclassing this, and overriding UUtilityAIComponent::CreateScoringSnapshot
+ * and UUtilityAIComponent::CaptureScoringSnapshot.
+ */
+struct UTILITYAI_API FUtilityAIScoringSnapshot
+{
+	virtual ~FUtilityAIScoringSnapshot() = default;
+
+	/** The world time when the snapshot was captured. */
+	double WorldTime = 0.0;
+
+	/** The tags owned by the AIController. */
+	FGameplayTagContainer OwnerTags;
+
+	/** Does the AIController have a pawn? If false, the pawn values are not valid. */
+	bool bHasPawn = false;
+
+	FVector PawnLocation = FVector::ZeroVector;
+
+	FRotator PawnRotation = FRotator::ZeroRotator;
+
+	FVector PawnVelocity = FVector::ZeroVector;
+};
@@ -3,6 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "UtilityAITypes.h"
+#include "Kismet/BlueprintFunctionLibrary.h"
 #include "UtilityAIStatics.generated.h"
 
 
@@ -21,4 +23,15 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, Category = "AI|UtilityAI")
 	static float CombineWeightedScores(TArray<float> Scores, TArray<float> Weights);
+
+	/** Combine 0..1 element scores using an operation. Returns 0 if there are no scores. */
+	static float CombineScores(TConstArrayView<float> Scores, EUtilityAIScoreOperation Operation);
+
+	/** Return the score of each element in a set of scoring elements. */
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	static TArray<float> GetScoringElementScores(const FUtilityAIScoringElements& ScoringElements);
+
+	/** Return the name of each element in a set of scoring elements. Names are None unless they were captured for debugging. */
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	static TArray<FName> GetScoringElementNames(const FUtilityAIScoringElements& ScoringElements);
 };
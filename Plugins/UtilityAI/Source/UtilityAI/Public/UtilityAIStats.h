@@ -0,0 +1,33 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+DECLARE_STATS_GROUP(TEXT("UtilityAI"), STATGROUP_UtilityAI, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_UtilityAI_Tick, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Select Action"), STAT_UtilityAI_SelectAction, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Score"), STAT_UtilityAI_UpdateScore, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Blueprint Score"), STAT_UtilityAI_BlueprintScore, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Start Execute"), STAT_UtilityAI_StartExecute, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Start Abort"), STAT_UtilityAI_StartAbort, STATGROUP_UtilityAI, UTILITYAI_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actions Scored"), STAT_UtilityAI_ActionsScored, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Actions Pruned"), STAT_UtilityAI_ActionsPruned, STATGROUP_UtilityAI, UTILITYAI_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Action Switches"), STAT_UtilityAI_ActionSwitches, STATGROUP_UtilityAI, UTILITYAI_API);
+
+/** Trace channel for utility AI events. Enable with -trace=cpu,UtilityAI. */
+UE_TRACE_CHANNEL_EXTERN(UtilityAIChannel, UTILITYAI_API);
+
+/** Measure a scope with a stat, and trace it on the UtilityAI channel. */
+#define UTILITYAI_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, UtilityAIChannel)
+
+/** Trace a nested scope named after an action's class, only resolving the name when the channel is enabled. */
+#define UTILITYAI_TRACE_ACTION_SCOPE(Action) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*(Action).GetDefinition().TraceName, UtilityAIChannel)
@@ -0,0 +1,162 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UtilityAISubsystem.generated.h"
+
+
+
+/**
+ * Tick state for a UtilityAIComponent that is ticked by the UtilityAISubsystem.
+ */
+USTRUCT()
+struct FUtilityAIAgentTickInfo
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<UUtilityAIComponent> Component;
+
+	/** The time between updates for this agent. */
+	float TickInterval = 0.f;
+
+	/** The remaining time until this agent updates. */
+	float TimeUntilTick = 0.f;
+
+	/** The time elapsed since this agent last updated. */
+	float TimeSinceTick = 0.f;
+
+	/** The time elapsed since this agent last selected an action. Can exceed the tick interval when decisions are deferred. */
+	float TimeSinceDecision = 0.f;
+
+	/** The moving average time this agent takes to select an action, in milliseconds. */
+	float AverageDecisionMs = 0.f;
+};
+
+
+/**
+ * Information about the decisions made by the UtilityAISubsystem during the last frame.
+ */
+USTRUCT(BlueprintType)
+struct FUtilityAISchedulerStats
+{
+	GENERATED_BODY()
+
+	/** The number of agents that were due to select an action. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumDue = 0;
+
+	/** The number of agents that selected an action. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumEvaluated = 0;
+
+	/** The number of agents that were due but deferred to a later frame because the decision budget was spent. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumDeferred = 0;
+
+	/** The number of agents that selected an action despite the budget being spent, because they reached the max staleness. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumForced = 0;
+
+	/** The time spent selecting actions, in milliseconds. Doesn't include ticking the current actions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float DecisionTimeMs = 0.f;
+
+	/** The longest time any agent had gone without selecting an action, in seconds. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float MaxStaleness = 0.f;
+
+	/** The total number of deferred decisions. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 TotalDeferred = 0;
+};
+
+
+/**
+ * Ticks all registered UtilityAIComponents in a single batched loop.
+ * Each component keeps its own tick interval, and components are staggered so they don't all update on the same frame.
+ * Components opt in using bUseSubsystemTick.
+ *
+ * When ai.Utility.DecisionBudgetMs is set, the time spent selecting actions each frame is capped. Due agents are
+ * ranked by distance to viewers, whether they're in combat, and how long since they last decided. Agents that miss
+ * the budget keep ticking their current action and decide on a later frame, but never go longer than
+ * ai.Utility.MaxDecisionStaleness without deciding.
+ *
+ * When ai.Utility.ParallelScoring is enabled, actions with thread-safe scoring are scored for all deciding agents
+ * at once on worker threads, while other actions are still scored on the game thread.
+ */
+UCLASS()
+class UTILITYAI_API UUtilityAISubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Start ticking a component. */
+	void RegisterComponent(UUtilityAIComponent* Component);
+
+	/** Stop ticking a component. */
+	void UnregisterComponent(UUtilityAIComponent* Component);
+
+	/** Return the number of components being ticked. */
+	int32 GetNumComponents() const { return Agents.Num(); }
+
+	/** Return information about the decisions made during the last frame. */
+	UFUNCTION(BlueprintPure, Category = "AI|UtilityAI")
+	FUtilityAISchedulerStats GetSchedulerStats() const { return SchedulerStats; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/** All registered components and their tick state, stored contiguously. */
+	UPROPERTY(Transient)
+	TArray<FUtilityAIAgentTickInfo> Agents;
+
+	/** Incremented for each registered component, used to stagger their first tick. */
+	int32 StaggerCounter = 0;
+
+	/** Information about the decisions made during the last frame. */
+	UPROPERTY(Transient)
+	FUtilityAISchedulerStats SchedulerStats;
+
+	/** An agent that is due to select an action this frame. */
+	struct FDueAgent
+	{
+		UUtilityAIComponent* Component = nullptr;
+		float Priority = 0.f;
+		bool bIsOverdue = false;
+	};
+
+	/** Agents due to select an action this frame, reused between frames. */
+	TArray<FDueAgent> DueAgents;
+
+	/** Locations of all player viewpoints this frame, reused between frames. */
+	TArray<FVector> ViewLocations;
+
+	/** Agents selecting an action this frame using parallel scoring, reused between frames. */
+	TArray<UUtilityAIComponent*> DecidingAgents;
+
+	/** Actions of all deciding agents to score on worker threads, reused between frames. */
+	TArray<FUtilityAIPendingScore> PendingScores;
+
+	/** Select actions for due agents one at a time. */
+	void TickDueAgents(bool bIsBudgeted, float BudgetMs);
+
+	/** Select actions for due agents, scoring thread-safe actions of all agents in parallel. */
+	void TickDueAgentsParallel(bool bIsBudgeted, float BudgetMs);
+
+	/** Update the moving average decision time of an agent. */
+	static void UpdateAverageDecisionMs(FUtilityAIAgentTickInfo& Agent, float DecisionMs);
+
+	/** Remove an agent, and update the index of the agent that replaces it. */
+	void RemoveAgentAt(int32 Idx);
+
+	/** Gather the locations of local players, or all players when running as a server. */
+	void UpdateViewLocations();
+
+	/** Return the priority of an agent's decision, higher priority agents decide first when over budget. */
+	float CalculatePriority(const FUtilityAIAgentTickInfo& Agent, float MaxStaleness) const;
+};
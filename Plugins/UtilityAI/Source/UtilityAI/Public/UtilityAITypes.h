@@ -12,8 +12,8 @@
 UENUM(BlueprintType)
 enum class EUtilityAIScoringMethod : uint8
 {
-	// Scoring is be done via combining available blackboard data with various transformations
-	Data UMETA(DisplayName = "Data (Not Implemented)"),
+	// Scoring is done by combining the action's considerations, each mapping an input value through a response curve
+	Data,
 	// Scoring is done by calling a custom scoring function on the action
 	Function,
 };
@@ -32,6 +32,164 @@ enum class EUtilityAIScoreOperation : uint8
 };
 
 
+/** Methods for visiting and scoring actions when selecting the best one. */
+UENUM(BlueprintType)
+enum class EUtilityAISelectionMode : uint8
+{
+	/** Score every action, in the order they were added. */
+	Exhaustive,
+	/**
+	 * Score actions from highest to lowest ScoreWeight, and stop once the remaining weights can't beat the best score.
+	 * Assumes actions calculate 0..1 scores before their weight is applied.
+	 */
+	BranchAndBound,
+};
+
+
+/**
+ * Information about the work done while selecting actions.
+ */
+USTRUCT(BlueprintType)
+struct FUtilityAISelectionStats
+{
+	GENERATED_BODY()
+
+	/** The number of actions scored during the last selection. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumScored = 0;
+
+	/**
+	 * The number of actions skipped during the last selection because their weight couldn't beat the best score.
+	 * Actions that weren't scored for other reasons, e.g. tag requirements or clean scores, aren't counted.
+	 */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumPruned = 0;
+
+	/** The total number of actions scored since the component was activated. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 TotalScored = 0;
+
+	/** The total number of actions pruned since the component was activated. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int64 TotalPruned = 0;
+};
+
+
+/**
+ * The runtime state of an action for a single agent.
+ * Stored contiguously by the UtilityAIComponent, separate from the action's definition.
+ */
+USTRUCT(BlueprintType)
+struct FUtilityAIActionState
+{
+	GENERATED_BODY()
+
+	/** The current score for the action. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float Score = 0.f;
+
+	/** The number of times the action has been executed. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 ExecuteCount = 0;
+
+	/** If > 0, the time at which the action was last executed. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float LastExecuteTime = -1000.f;
+
+	/** If > 0, the time at which the action was last finished. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float LastFinishTime = -1000.f;
+
+	/** The world time when the score was last calculated. */
+	double LastScoreTime = 0.0;
+
+	/** Is the action currently being executed? */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool bIsExecuting = false;
+
+	/** Is the action currently being aborted? */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool bIsAborting = false;
+
+	/** Is the score locked at its current value? */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool bIsScoreFrozen = false;
+
+	/** Has a dependency of the score changed since it was last calculated? */
+	bool bIsScoreDirty = true;
+};
+
+
+/**
+ * A fixed-width set of tags, where each bit is a tag from a UtilityAIComponent's tag table.
+ * Used to match compiled tag requirements with a few bitwise operations.
+ */
+struct FUtilityAITagBits
+{
+	static constexpr int32 NumWords = 2;
+	static constexpr int32 NumBits = NumWords * 64;
+
+	uint64 Words[NumWords] = {};
+
+	void SetBit(int32 Index)
+	{
+		Words[Index / 64] |= uint64(1) << (Index % 64);
+	}
+
+	void Reset()
+	{
+		for (uint64& Word : Words)
+		{
+			Word = 0;
+		}
+	}
+
+	bool IsEmpty() const
+	{
+		for (const uint64 Word : Words)
+		{
+			if (Word != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Return true if all bits in Other are set. */
+	bool HasAll(const FUtilityAITagBits& Other) const
+	{
+		for (int32 Idx = 0; Idx < NumWords; ++Idx)
+		{
+			if ((Words[Idx] & Other.Words[Idx]) != Other.Words[Idx])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Return true if any bits in Other are set. */
+	bool HasAny(const FUtilityAITagBits& Other) const
+	{
+		for (int32 Idx = 0; Idx < NumWords; ++Idx)
+		{
+			if ((Words[Idx] & Other.Words[Idx]) != 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+
+/** Can scoring element names be captured? Names are only used for debugging, and cost time to store. */
+#ifndef UTILITYAI_WITH_SCORE_NAMES
+#define UTILITYAI_WITH_SCORE_NAMES WITH_GAMEPLAY_DEBUGGER
+#endif
+
+
 /**
  * Represents a single scoring element calculated by a UtilityAIAction.
  */
@@ -44,34 +202,59 @@ struct FUtilityAIScore
 	float Score = 0.f;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	FString Name;
+	FName Name;
 };
 
 
 /**
  * Represents a set of scoring elements that make up a final score.
+ * Elements are stored inline, so that scoring typical actions doesn't allocate.
  */
 USTRUCT(BlueprintType)
 struct FUtilityAIScoringElements
 {
 	GENERATED_BODY()
 
-	/** The individual scores for each element. */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	TArray<float> Scores;
+	static constexpr int32 NumInlineElements = 8;
 
-	/** The names of each score element. */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	TArray<FString> Names;
+	/** The individual scores for each element. Read from blueprints with GetScoringElementScores. */
+	TArray<float, TInlineAllocator<NumInlineElements>> Scores;
+
+#if UTILITYAI_WITH_SCORE_NAMES
+	/** The names of each score element. Only captured when bCaptureNames is set. Read from blueprints with GetScoringElementNames. */
+	TArray<FName, TInlineAllocator<NumInlineElements>> Names;
+#endif
 
 	/** The operation to use when combining the scores. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	EUtilityAIScoreOperation Operation = EUtilityAIScoreOperation::Multiply;
 
-	void AddScore(float Score, const FString& Name)
+	/**
+	 * The number of elements that were not evaluated because the final score was already known,
+	 * or could no longer be high enough to be selected.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 NumSkipped = 0;
+
+	/**
+	 * Did scoring stop because the score could no longer be high enough to be selected?
+	 * The score is then only an upper bound, even if no elements were skipped.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bStoppedEarly = false;
+
+	/** Should element names be stored? Usually only enabled for the agent being debugged. */
+	bool bCaptureNames = false;
+
+	void AddScore(float Score, FName Name)
 	{
 		Scores.Add(Score);
-		Names.Add(Name);
+#if UTILITYAI_WITH_SCORE_NAMES
+		if (bCaptureNames)
+		{
+			Names.Add(Name);
+		}
+#endif
 	}
 
 	void AddScore(const FUtilityAIScore& ElementScore)
@@ -79,9 +262,53 @@ struct FUtilityAIScoringElements
 		AddScore(ElementScore.Score, ElementScore.Name);
 	}
 
+	/** Return the name of an element, or None if names weren't captured. */
+	FName GetName(int32 Index) const
+	{
+#if UTILITYAI_WITH_SCORE_NAMES
+		return Names.IsValidIndex(Index) ? Names[Index] : NAME_None;
+#else
+		return NAME_None;
+#endif
+	}
+
 	void Reset()
 	{
 		Scores.Reset();
+#if UTILITYAI_WITH_SCORE_NAMES
 		Names.Reset();
+#endif
+		NumSkipped = 0;
+		bStoppedEarly = false;
 	}
 };
+
+
+/**
+ * Combines 0..1 element scores one at a time, and reports when the remaining elements can be skipped.
+ * Shared by every path that scores considerations, so they all stop early in the same way.
+ */
+struct UTILITYAI_API FUtilityAIScoreCombiner
+{
+	/** ScoreToBeat is the weighted score that must be beaten to be selected, or negative to never stop early. */
+	FUtilityAIScoreCombiner(EUtilityAIScoreOperation InOperation, float InScoreWeight, float ScoreToBeat);
+
+	/** Combine the next element score. Return true if the remaining elements can't change the outcome and should be skipped. */
+	bool Add(float ElementScore);
+
+	/** Return the unweighted result, or 0 if there were no elements or scoring stopped early below the threshold. */
+	float GetResult() const { return bHasResult && !bStoppedEarly ? Result : 0.f; }
+
+	/** Did scoring stop because the result could no longer beat the threshold? */
+	bool IsStoppedEarly() const { return bStoppedEarly; }
+
+private:
+	EUtilityAIScoreOperation Operation;
+	float ScoreWeight;
+	/** The weighted result must be higher than this to be selected. */
+	float MinScore;
+	bool bCanStopEarly;
+	bool bHasResult = false;
+	bool bStoppedEarly = false;
+	float Result;
+};
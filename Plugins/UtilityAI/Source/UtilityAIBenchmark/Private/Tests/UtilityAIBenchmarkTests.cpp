@@ -0,0 +1,89 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "CoreMinimal.h"
+#include "UtilityAIBenchmarkCommandlet.h"
+#include "Interfaces/IPluginManager.h"
+#include "Dom/JsonObject.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/StrongObjectPtr.h"
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UtilityAIBenchmarkTests
+{
+	int32 RunCommandlet(const FString& Params)
+	{
+		const TStrongObjectPtr<UUtilityAIBenchmarkCommandlet> Commandlet(NewObject<UUtilityAIBenchmarkCommandlet>());
+		return Commandlet->Main(Params);
+	}
+
+	/** Return the micro benchmark baseline stored with the plugin. */
+	FString GetMicroBaselinePath()
+	{
+		const TSharedPtr<IPlugin> Plugin = IPluginManager::Get().FindPlugin(TEXT("UtilityAI"));
+		return Plugin ? FPaths::Combine(Plugin->GetBaseDir(), TEXT("Benchmarks"), TEXT("MicroBaseline.json")) : FString();
+	}
+
+	/** Return the number of benchmarks in a baseline file, or 0 if it can't be read. */
+	int32 GetNumBaselineBenchmarks(const FString& BaselinePath)
+	{
+		FString BaselineString;
+		TSharedPtr<FJsonObject> Baseline;
+		const TSharedPtr<FJsonObject>* Benchmarks = nullptr;
+		if (!FFileHelper::LoadFileToString(BaselineString, *BaselinePath) ||
+			!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), Baseline) || !Baseline ||
+			!Baseline->TryGetObjectField(TEXT("benchmarks"), Benchmarks) || !Benchmarks->IsValid())
+		{
+			return 0;
+		}
+		return (*Benchmarks)->Values.Num();
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUtilityAIBenchmarkLoadTest, "UtilityAI.Benchmark.Load",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FUtilityAIBenchmarkLoadTest::RunTest(const FString& Parameters)
+{
+	for (const TCHAR* ScoringMethod : {TEXT("Function"), TEXT("Data")})
+	{
+		const FString Params = FString::Printf(TEXT("-Agents=50 -Ticks=60 -ScoringMethod=%s"), ScoringMethod);
+		TestEqual(FString::Printf(TEXT("%s scoring exit code"), ScoringMethod), UtilityAIBenchmarkTests::RunCommandlet(Params), 0);
+	}
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUtilityAIBenchmarkMicroTest, "UtilityAI.Benchmark.Micro",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FUtilityAIBenchmarkMicroTest::RunTest(const FString& Parameters)
+{
+	// fails if any benchmark regressed from the stored baseline
+	FString Params = TEXT("-Micro");
+	const FString BaselinePath = UtilityAIBenchmarkTests::GetMicroBaselinePath();
+	if (!FPaths::FileExists(BaselinePath))
+	{
+		AddWarning(FString::Printf(TEXT("No micro benchmark baseline at %s"), *BaselinePath));
+	}
+	else if (UtilityAIBenchmarkTests::GetNumBaselineBenchmarks(BaselinePath) == 0)
+	{
+		// nothing can be compared, so regressions would pass unnoticed
+		AddWarning(FString::Printf(TEXT("The micro benchmark baseline at %s has no results, record one with -Output"), *BaselinePath));
+	}
+	else
+	{
+		Params += FString::Printf(TEXT(" -Baseline=\"%s\""), *BaselinePath);
+	}
+
+	TestEqual(TEXT("Micro benchmarks exit code"), UtilityAIBenchmarkTests::RunCommandlet(Params), 0);
+	return true;
+}
+
+#endif
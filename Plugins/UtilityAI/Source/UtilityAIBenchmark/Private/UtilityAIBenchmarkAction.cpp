@@ -0,0 +1,67 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIBenchmarkAction.h"
+
+
+UUtilityAIBenchmarkAction::UUtilityAIBenchmarkAction()
+{
+	ScoringMethod = EUtilityAIScoringMethod::Function;
+
+	// scoring only uses this action's own random stream
+	bIsCustomScoringThreadSafe = true;
+}
+
+void UUtilityAIBenchmarkAction::Initialize()
+{
+	Super::Initialize();
+
+	ScoreRandom.Initialize(static_cast<int32>(GetTypeHash(GetPathName())));
+}
+
+float UUtilityAIBenchmarkAction::CalculateCustomScore()
+{
+	float Work = 0.f;
+	for (int32 Idx = 0; Idx < ScoringCost; ++Idx)
+	{
+		Work += FMath::Sin(static_cast<float>(Idx) * BaseScore);
+	}
+
+	// keep the busy work from being optimized away, without meaningfully changing the score
+	const float Jitter = ScoreJitter * (ScoreRandom.GetFraction() - 0.5f) + Work * UE_SMALL_NUMBER;
+	return FMath::Clamp(BaseScore * (1.f + Jitter), 0.f, 1.f);
+}
+
+void UUtilityAIBenchmarkAction::Execute()
+{
+}
+
+
+UUtilityAIBenchmarkDataAction::UUtilityAIBenchmarkDataAction()
+{
+	ScoringMethod = EUtilityAIScoringMethod::Data;
+	bCanScoreFromClassDefault = true;
+}
+
+void UUtilityAIBenchmarkDataAction::Execute()
+{
+}
+
+
+float UUtilityAIBenchmarkInput::GetValue(const FUtilityAIConsiderationContext& Context) const
+{
+	float Work = 0.f;
+	for (int32 Idx = 0; Idx < Cost; ++Idx)
+	{
+		Work += FMath::Sin(static_cast<float>(Idx) * Value);
+	}
+
+	// keep the busy work from being optimized away, without meaningfully changing the value
+	return FMath::Clamp(Value + Work * UE_SMALL_NUMBER, 0.f, 1.f);
+}
+
+
+void AUtilityAIBenchmarkController::GetOwnedGameplayTags(FGameplayTagContainer& TagContainer) const
+{
+	TagContainer = OwnedTags;
+}
@@ -0,0 +1,707 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIBenchmarkCommandlet.h"
+
+#include "GameplayTagsManager.h"
+#include "UtilityAIActionDefinition.h"
+#include "UtilityAIActionSet.h"
+#include "UtilityAIBenchmarkAction.h"
+#include "UtilityAIBenchmarkComponent.h"
+#include "UtilityAIBenchmarkMalloc.h"
+#include "UtilityAIBenchmarkModule.h"
+#include "UtilityAIComponent.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIMicroBenchmarks.h"
+#include "Considerations/UtilityAIInput_OwnerTags.h"
+#include "UtilityAIStatics.h"
+#include "UtilityAISubsystem.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonSerializer.h"
+
+
+namespace UtilityAIBenchmark
+{
+	/** The most tags to use from the project's tag table. */
+	constexpr int32 MaxTags = 64;
+
+	const TCHAR* LexToString(EUtilityAIBenchmarkScoreDistribution Distribution)
+	{
+		switch (Distribution)
+		{
+		case EUtilityAIBenchmarkScoreDistribution::Uniform:
+			return TEXT("Uniform");
+		case EUtilityAIBenchmarkScoreDistribution::Skewed:
+			return TEXT("Skewed");
+		case EUtilityAIBenchmarkScoreDistribution::Flat:
+			return TEXT("Flat");
+		default:
+			return TEXT("Unknown");
+		}
+	}
+
+	float RandomScore(EUtilityAIBenchmarkScoreDistribution Distribution, FRandomStream& Random)
+	{
+		switch (Distribution)
+		{
+		case EUtilityAIBenchmarkScoreDistribution::Uniform:
+			return Random.GetFraction();
+		case EUtilityAIBenchmarkScoreDistribution::Skewed:
+			return FMath::Pow(Random.GetFraction(), 4.f);
+		case EUtilityAIBenchmarkScoreDistribution::Flat:
+		default:
+			return 0.5f + 0.01f * Random.GetFraction();
+		}
+	}
+
+	/** Return the value at a 0..1 percentile of sorted values. */
+	double Percentile(TConstArrayView<double> SortedValues, double Pct)
+	{
+		if (SortedValues.IsEmpty())
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::Clamp(FMath::CeilToInt32(Pct * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+}
+
+
+void FUtilityAIBenchmarkSettings::Parse(const FString& Params)
+{
+	FParse::Value(*Params, TEXT("Agents="), NumAgents);
+	FParse::Value(*Params, TEXT("Actions="), NumActions);
+	FParse::Value(*Params, TEXT("Ticks="), NumTicks);
+	FParse::Value(*Params, TEXT("WarmupTicks="), NumWarmupTicks);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("ScoringCost="), ScoringCost);
+	FParse::Value(*Params, TEXT("Considerations="), NumConsiderationsPerAction);
+	FParse::Value(*Params, TEXT("TagsPerAction="), NumTagsPerAction);
+	FParse::Value(*Params, TEXT("TagChurn="), TagChurn);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	bUseSubsystemTick = FParse::Param(*Params, TEXT("Subsystem"));
+
+	FString DistributionName;
+	if (FParse::Value(*Params, TEXT("Distribution="), DistributionName))
+	{
+		for (const EUtilityAIBenchmarkScoreDistribution Distribution : {
+			     EUtilityAIBenchmarkScoreDistribution::Uniform,
+			     EUtilityAIBenchmarkScoreDistribution::Skewed,
+			     EUtilityAIBenchmarkScoreDistribution::Flat
+		     })
+		{
+			if (DistributionName.Equals(UtilityAIBenchmark::LexToString(Distribution)))
+			{
+				ScoreDistribution = Distribution;
+			}
+		}
+	}
+
+	FString ScoringMethodName;
+	if (FParse::Value(*Params, TEXT("ScoringMethod="), ScoringMethodName))
+	{
+		const int64 Value = StaticEnum<EUtilityAIScoringMethod>()->GetValueByNameString(ScoringMethodName);
+		if (Value != INDEX_NONE)
+		{
+			ScoringMethod = static_cast<EUtilityAIScoringMethod>(Value);
+		}
+	}
+
+	FString SelectionModeName;
+	if (FParse::Value(*Params, TEXT("SelectionMode="), SelectionModeName))
+	{
+		const int64 Value = StaticEnum<EUtilityAISelectionMode>()->GetValueByNameString(SelectionModeName);
+		if (Value != INDEX_NONE)
+		{
+			SelectionMode = static_cast<EUtilityAISelectionMode>(Value);
+		}
+	}
+
+	NumAgents = FMath::Max(NumAgents, 1);
+	NumActions = FMath::Max(NumActions, 1);
+	NumTicks = FMath::Max(NumTicks, 1);
+	NumWarmupTicks = FMath::Max(NumWarmupTicks, 0);
+	NumTagsPerAction = FMath::Max(NumTagsPerAction, 0);
+	ScoringCost = FMath::Max(ScoringCost, 0);
+	NumConsiderationsPerAction = FMath::Max(NumConsiderationsPerAction, 1);
+}
+
+TSharedRef<FJsonObject> FUtilityAIBenchmarkSettings::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("agents"), NumAgents);
+	Json->SetNumberField(TEXT("actions"), NumActions);
+	Json->SetNumberField(TEXT("ticks"), NumTicks);
+	Json->SetNumberField(TEXT("warmupTicks"), NumWarmupTicks);
+	Json->SetNumberField(TEXT("deltaTime"), DeltaTime);
+	Json->SetNumberField(TEXT("scoringCost"), ScoringCost);
+	Json->SetStringField(TEXT("scoringMethod"), StaticEnum<EUtilityAIScoringMethod>()->GetNameStringByValue(static_cast<int64>(ScoringMethod)));
+	Json->SetNumberField(TEXT("considerations"), NumConsiderationsPerAction);
+	Json->SetNumberField(TEXT("tagsPerAction"), NumTagsPerAction);
+	Json->SetNumberField(TEXT("tagChurn"), TagChurn);
+	Json->SetStringField(TEXT("distribution"), UtilityAIBenchmark::LexToString(ScoreDistribution));
+	Json->SetStringField(TEXT("selectionMode"), StaticEnum<EUtilityAISelectionMode>()->GetNameStringByValue(static_cast<int64>(SelectionMode)));
+	Json->SetBoolField(TEXT("subsystem"), bUseSubsystemTick);
+	Json->SetNumberField(TEXT("seed"), Seed);
+	return Json;
+}
+
+TSharedRef<FJsonObject> FUtilityAIBenchmarkResults::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("meanTickMs"), MeanTickMs);
+	Json->SetNumberField(TEXT("p99TickMs"), P99TickMs);
+	Json->SetNumberField(TEXT("maxTickMs"), MaxTickMs);
+	Json->SetNumberField(TEXT("meanAgentUs"), MeanAgentUs);
+	Json->SetBoolField(TEXT("hasAllocations"), bHasAllocations);
+	if (bHasAllocations)
+	{
+		Json->SetNumberField(TEXT("allocationsPerTick"), AllocationsPerTick);
+		Json->SetNumberField(TEXT("allocatedBytesPerTick"), AllocatedBytesPerTick);
+		Json->SetNumberField(TEXT("memoryPerAgentBytes"), MemoryPerAgentBytes);
+	}
+	Json->SetNumberField(TEXT("actionsScoredPerTick"), ActionsScoredPerTick);
+	return Json;
+}
+
+
+UUtilityAIBenchmarkCommandlet::UUtilityAIBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UUtilityAIBenchmarkCommandlet::Main(const FString& Params)
+{
+	FUtilityAIBenchmarkSettings Settings;
+	Settings.Parse(Params);
+
+	// an empty world, no map is loaded
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("UtilityAIBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	if (FParse::Param(*Params, TEXT("Micro")))
+	{
+		const int32 ExitCode = RunMicroBenchmarks(World, Params);
+
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		return ExitCode;
+	}
+
+	FUtilityAIBenchmarkResults Results;
+	RunBenchmark(World, Settings, Results);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	const TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetObjectField(TEXT("settings"), Settings.ToJson());
+	Json->SetObjectField(TEXT("results"), Results.ToJson());
+
+	FString JsonString;
+	FJsonSerializer::Serialize(Json, TJsonWriterFactory<>::Create(&JsonString));
+	UE_LOG(LogUtilityAIBenchmark, Display, TEXT("%s"), *JsonString);
+
+	if (!Settings.OutputPath.IsEmpty() && !FFileHelper::SaveStringToFile(JsonString, *Settings.OutputPath))
+	{
+		UE_LOG(LogUtilityAIBenchmark, Error, TEXT("Failed to write results to %s"), *Settings.OutputPath);
+		return 1;
+	}
+	return 0;
+}
+
+UUtilityAIActionSet* UUtilityAIBenchmarkCommandlet::CreateActionSet(const FUtilityAIBenchmarkSettings& Settings,
+                                                                    TConstArrayView<FGameplayTag> Tags, FRandomStream& Random)
+{
+	UUtilityAIActionSet* ActionSet = NewObject<UUtilityAIActionSet>(GetTransientPackage());
+
+	const bool bIsData = Settings.ScoringMethod == EUtilityAIScoringMethod::Data;
+	TArray<TObjectPtr<UClass>>& Classes = bIsData ? DataActionClasses : ActionClasses;
+	UClass* SuperClass = bIsData ? UUtilityAIBenchmarkDataAction::StaticClass() : UUtilityAIBenchmarkAction::StaticClass();
+
+	for (int32 Idx = 0; Idx < Settings.NumActions; ++Idx)
+	{
+		if (!Classes.IsValidIndex(Idx))
+		{
+			Classes.Add(CreateActionClass(SuperClass, Idx));
+		}
+
+		// all instances are created from the class defaults
+		UUtilityAIAction* DefaultAction = Classes[Idx]->GetDefaultObject<UUtilityAIAction>();
+		const float BaseScore = UtilityAIBenchmark::RandomScore(Settings.ScoreDistribution, Random);
+		if (UUtilityAIBenchmarkAction* FunctionAction = Cast<UUtilityAIBenchmarkAction>(DefaultAction))
+		{
+			FunctionAction->BaseScore = BaseScore;
+			FunctionAction->ScoringCost = Settings.ScoringCost;
+		}
+		else
+		{
+			CreateConsiderations(Settings, DefaultAction, BaseScore, Tags, Random);
+		}
+
+		DefaultAction->RequireTags.Reset();
+		DefaultAction->IgnoreTags.Reset();
+		for (int32 TagIdx = 0; TagIdx < Settings.NumTagsPerAction && !Tags.IsEmpty(); ++TagIdx)
+		{
+			const FGameplayTag& Tag = Tags[Random.RandHelper(Tags.Num())];
+			FGameplayTagContainer& Requirement = Random.GetFraction() < 0.5f ? DefaultAction->RequireTags : DefaultAction->IgnoreTags;
+			Requirement.AddTag(Tag);
+		}
+
+		ActionSet->Actions.Add(Classes[Idx], Random.FRandRange(0.5f, 1.5f));
+	}
+
+	// classes are reused between runs, and their definitions hold the previous run's considerations
+	FUtilityAIActionDefinition::RefreshAll();
+
+	ActionSet->Compile();
+	return ActionSet;
+}
+
+void UUtilityAIBenchmarkCommandlet::CreateConsiderations(const FUtilityAIBenchmarkSettings& Settings, UUtilityAIAction* DefaultAction,
+                                                         float BaseScore, TConstArrayView<FGameplayTag> Tags, FRandomStream& Random)
+{
+	DefaultAction->Considerations.Reset();
+	DefaultAction->ConsiderationOperation = EUtilityAIScoreOperation::Multiply;
+
+	const bool bHasTagGate = !Tags.IsEmpty() && Settings.NumConsiderationsPerAction > 1;
+	for (int32 Idx = 0; Idx < Settings.NumConsiderationsPerAction; ++Idx)
+	{
+		UUtilityAIConsideration* Consideration = NewObject<UUtilityAIConsideration>(GetTransientPackage());
+
+		if (Idx == 0 && bHasTagGate)
+		{
+			// a cheap gate on the owner's tags, which fails for about half of the agents
+			UUtilityAIInput_OwnerTags* Input = NewObject<UUtilityAIInput_OwnerTags>(Consideration);
+			Input->Tags.AddTag(Tags[Random.RandHelper(Tags.Num())]);
+			Consideration->Input = Input;
+			Consideration->ResponseCurve.Type = EUtilityAIResponseCurveType::Step;
+			Consideration->ResponseCurve.XShift = 0.5f;
+			Consideration->Cost = 0.f;
+		}
+		else
+		{
+			// the first synthetic input decides the score, the rest only reduce it slightly, keeping the score distribution
+			const bool bIsFirstInput = Idx == (bHasTagGate ? 1 : 0);
+			UUtilityAIBenchmarkInput* Input = NewObject<UUtilityAIBenchmarkInput>(Consideration);
+			Input->Value = bIsFirstInput ? BaseScore : Random.FRandRange(0.9f, 1.f);
+			Input->Cost = Settings.ScoringCost / Settings.NumConsiderationsPerAction;
+			Consideration->Input = Input;
+			Consideration->Cost = Random.FRandRange(1.f, 2.f);
+		}
+
+		DefaultAction->Considerations.Add(Consideration);
+	}
+}
+
+UClass* UUtilityAIBenchmarkCommandlet::CreateActionClass(UClass* SuperClass, int32 Index)
+{
+	const FName ClassName(*FString::Printf(TEXT("%s_%d"), *SuperClass->GetName(), Index));
+
+	// a subclass with no new properties, constructed using the native class constructor
+	UClass* ActionClass = NewObject<UClass>(GetTransientPackage(), ClassName, RF_Public | RF_Transient);
+	ActionClass->SetSuperStruct(SuperClass);
+	ActionClass->ClassFlags |= SuperClass->ClassFlags & CLASS_Inherit;
+	ActionClass->ClassCastFlags |= SuperClass->ClassCastFlags;
+	ActionClass->ClassWithin = SuperClass->ClassWithin;
+	ActionClass->Bind();
+	ActionClass->StaticLink(true);
+	ActionClass->AssembleReferenceTokenStream();
+	ActionClass->GetDefaultObject();
+	return ActionClass;
+}
+
+TArray<FGameplayTag> UUtilityAIBenchmarkCommandlet::GetBenchmarkTags()
+{
+	FGameplayTagContainer AllTags;
+	UGameplayTagsManager::Get().RequestAllGameplayTags(AllTags, true);
+	TArray<FGameplayTag> Tags = AllTags.GetGameplayTagArray();
+	Tags.SetNum(FMath::Min(Tags.Num(), UtilityAIBenchmark::MaxTags));
+	return Tags;
+}
+
+void UUtilityAIBenchmarkCommandlet::RunBenchmark(UWorld* World, const FUtilityAIBenchmarkSettings& Settings, FUtilityAIBenchmarkResults& OutResults)
+{
+	FRandomStream Random(Settings.Seed);
+
+	const TArray<FGameplayTag> Tags = GetBenchmarkTags();
+	if (Tags.IsEmpty() && Settings.NumTagsPerAction > 0)
+	{
+		UE_LOG(LogUtilityAIBenchmark, Warning, TEXT("The project has no gameplay tags, actions will have no tag requirements"));
+	}
+
+	UUtilityAIActionSet* ActionSet = CreateActionSet(Settings, Tags, Random);
+	UUtilityAISubsystem* Subsystem = World->GetSubsystem<UUtilityAISubsystem>();
+
+	// count everything allocated on the game thread from here on, including the agents themselves
+	FUtilityAIBenchmarkAllocationScope AllocationScope;
+	const FUtilityAIBenchmarkAllocationCounters& Allocations = AllocationScope.Get();
+	OutResults.bHasAllocations = AllocationScope.IsCounting();
+	if (!OutResults.bHasAllocations)
+	{
+		UE_LOG(LogUtilityAIBenchmark, Display, TEXT("Allocations are only counted when running as a commandlet"));
+	}
+
+	const int64 BytesBeforeSpawn = Allocations.AllocatedBytes - Allocations.FreedBytes;
+	TArray<AUtilityAIBenchmarkController*> Controllers;
+	TArray<UUtilityAIComponent*> Components;
+	Controllers.Reserve(Settings.NumAgents);
+	Components.Reserve(Settings.NumAgents);
+	for (int32 AgentIdx = 0; AgentIdx < Settings.NumAgents; ++AgentIdx)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		AUtilityAIBenchmarkController* Controller = World->SpawnActor<AUtilityAIBenchmarkController>(SpawnParams);
+		for (const FGameplayTag& Tag : Tags)
+		{
+			if (Random.GetFraction() < 0.5f)
+			{
+				Controller->OwnedTags.AddTag(Tag);
+			}
+		}
+
+		UUtilityAIComponent* Component = NewObject<UUtilityAIComponent>(Controller);
+		Component->SelectionMode = Settings.SelectionMode;
+		Component->bUseSubsystemTick = Settings.bUseSubsystemTick;
+		Component->DefaultActionSets.Add(ActionSet);
+		Component->RegisterComponent();
+		Component->Activate(true);
+
+		// ticked directly, so only decision making is measured
+		Component->SetComponentTickEnabled(false);
+
+		Controllers.Add(Controller);
+		Components.Add(Component);
+	}
+	// freeing blocks that were allocated before counting could make this negative, though spawning rarely does
+	const int64 BytesAfterSpawn = Allocations.AllocatedBytes - Allocations.FreedBytes;
+	OutResults.MemoryPerAgentBytes = static_cast<double>(FMath::Max<int64>(BytesAfterSpawn - BytesBeforeSpawn, 0)) / Settings.NumAgents;
+
+	TArray<double> TickTimes;
+	TickTimes.Reserve(Settings.NumTicks);
+	int64 NumAllocations = 0;
+	int64 AllocatedBytes = 0;
+	int64 NumScored = 0;
+
+	for (int32 TickIdx = 0; TickIdx < Settings.NumWarmupTicks + Settings.NumTicks; ++TickIdx)
+	{
+		World->TimeSeconds += Settings.DeltaTime;
+
+		for (AUtilityAIBenchmarkController* Controller : Controllers)
+		{
+			if (!Tags.IsEmpty() && Random.GetFraction() < Settings.TagChurn)
+			{
+				const FGameplayTag& Tag = Tags[Random.RandHelper(Tags.Num())];
+				if (!Controller->OwnedTags.RemoveTag(Tag))
+				{
+					Controller->OwnedTags.AddTag(Tag);
+				}
+			}
+		}
+
+		const int64 AllocationsBeforeTick = Allocations.NumAllocations;
+		const int64 BytesBeforeTick = Allocations.AllocatedBytes;
+		const double StartTime = FPlatformTime::Seconds();
+
+		if (Settings.bUseSubsystemTick && Subsystem)
+		{
+			Subsystem->Tick(Settings.DeltaTime);
+		}
+		else
+		{
+			for (UUtilityAIComponent* Component : Components)
+			{
+				Component->TickActions(Settings.DeltaTime);
+			}
+		}
+
+		const double TickMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		if (TickIdx < Settings.NumWarmupTicks)
+		{
+			continue;
+		}
+
+		TickTimes.Add(TickMs);
+		NumAllocations += Allocations.NumAllocations - AllocationsBeforeTick;
+		AllocatedBytes += Allocations.AllocatedBytes - BytesBeforeTick;
+		for (const UUtilityAIComponent* Component : Components)
+		{
+			NumScored += Component->GetSelectionStats().NumScored;
+		}
+	}
+
+	for (UUtilityAIComponent* Component : Components)
+	{
+		Component->Deactivate();
+	}
+	for (AUtilityAIBenchmarkController* Controller : Controllers)
+	{
+		Controller->Destroy();
+	}
+
+	double TotalMs = 0.0;
+	for (const double TickMs : TickTimes)
+	{
+		TotalMs += TickMs;
+	}
+	TickTimes.Sort();
+
+	const double NumTicks = TickTimes.Num();
+	OutResults.MeanTickMs = TotalMs / NumTicks;
+	OutResults.P99TickMs = UtilityAIBenchmark::Percentile(TickTimes, 0.99);
+	OutResults.MaxTickMs = TickTimes.Last();
+	OutResults.MeanAgentUs = OutResults.MeanTickMs * 1000.0 / Settings.NumAgents;
+	OutResults.AllocationsPerTick = NumAllocations / NumTicks;
+	OutResults.AllocatedBytesPerTick = AllocatedBytes / NumTicks;
+	OutResults.ActionsScoredPerTick = NumScored / NumTicks;
+}
+
+int32 UUtilityAIBenchmarkCommandlet::RunMicroBenchmarks(UWorld* World, const FString& Params)
+{
+	FUtilityAIMicroBenchmarkSettings Settings;
+	Settings.Parse(Params);
+	FUtilityAIMicroBenchmarks Benchmarks(Settings);
+
+	FRandomStream Random(0);
+	const TArray<FGameplayTag> Tags = GetBenchmarkTags();
+
+	// the first tag makes the agent busy, the rest are used for requirements
+	const FGameplayTag BusyTag = Tags.IsEmpty() ? FGameplayTag() : Tags[0];
+	const TConstArrayView<FGameplayTag> RequirementTags = Tags.IsEmpty() ? TConstArrayView<FGameplayTag>() : MakeArrayView(Tags).RightChop(1);
+
+	// an action for each size of tag requirements, matched against the owner's tags without being compiled,
+	// then one with the most tags that stays compiled, and one with a tag query
+	TArray<int32> RequirementSizes;
+	for (const int32 Size : {1, 8, 32})
+	{
+		RequirementSizes.AddUnique(FMath::Min(Size, RequirementTags.Num()));
+	}
+	RequirementSizes.Remove(0);
+	const int32 NumRequirementActions = RequirementSizes.Num() + (RequirementSizes.IsEmpty() ? 0 : 1);
+
+	UUtilityAIActionSet* ActionSet = NewObject<UUtilityAIActionSet>(GetTransientPackage());
+	for (int32 Idx = 0; Idx < NumRequirementActions + 1; ++Idx)
+	{
+		if (!ActionClasses.IsValidIndex(Idx))
+		{
+			ActionClasses.Add(CreateActionClass(UUtilityAIBenchmarkAction::StaticClass(), Idx));
+		}
+
+		UUtilityAIBenchmarkAction* DefaultAction = ActionClasses[Idx]->GetDefaultObject<UUtilityAIBenchmarkAction>();
+		DefaultAction->RequireTags.Reset();
+		DefaultAction->IgnoreTags.Reset();
+		DefaultAction->TagQuery = FGameplayTagQuery();
+		if (Idx < NumRequirementActions)
+		{
+			for (int32 TagIdx = 0; TagIdx < RequirementSizes[FMath::Min(Idx, RequirementSizes.Num() - 1)]; ++TagIdx)
+			{
+				DefaultAction->RequireTags.AddTag(RequirementTags[TagIdx]);
+			}
+		}
+		else if (!RequirementTags.IsEmpty())
+		{
+			FGameplayTagContainer QueryTags;
+			QueryTags.AddTag(RequirementTags.Last());
+			DefaultAction->TagQuery = FGameplayTagQuery::MakeQuery_MatchAllTags(QueryTags);
+		}
+
+		ActionSet->Actions.Add(ActionClasses[Idx], 1.f);
+	}
+	ActionSet->Compile();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AUtilityAIBenchmarkController* Controller = World->SpawnActor<AUtilityAIBenchmarkController>(SpawnParams);
+	for (const FGameplayTag& Tag : RequirementTags)
+	{
+		Controller->OwnedTags.AddTag(Tag);
+	}
+
+	UUtilityAIBenchmarkComponent* Component = NewObject<UUtilityAIBenchmarkComponent>(Controller);
+	if (BusyTag.IsValid())
+	{
+		Component->BusyTags.AddTag(BusyTag);
+	}
+	Component->DefaultActionSets.Add(ActionSet);
+	Component->RegisterComponent();
+	Component->Activate(true);
+	Component->SetComponentTickEnabled(false);
+
+	UUtilityAIAction* FirstAction = Component->GetAction(ActionClasses[0]);
+	UUtilityAIAction* QueryAction = Component->GetAction(ActionClasses[NumRequirementActions]);
+	for (int32 SizeIdx = 0; SizeIdx < RequirementSizes.Num(); ++SizeIdx)
+	{
+		Component->ClearCompiledTagRequirementsForBenchmark(ActionClasses[SizeIdx]);
+	}
+
+	// make the agent busy, so that CanActivateAction checks interruption rules
+	Component->SetCurrentActionForBenchmark(FirstAction);
+	if (BusyTag.IsValid())
+	{
+		Controller->OwnedTags.AddTag(BusyTag);
+	}
+	Component->UpdateScoringSnapshotForBenchmark();
+
+	TArray<float> Scores;
+	TArray<float> Weights;
+	for (int32 Idx = 0; Idx < FUtilityAIScoringElements::NumInlineElements; ++Idx)
+	{
+		Scores.Add(Random.GetFraction());
+		Weights.Add(Random.FRandRange(0.5f, 1.5f));
+	}
+
+	for (const EUtilityAIScoreOperation Operation : {EUtilityAIScoreOperation::Multiply, EUtilityAIScoreOperation::Max, EUtilityAIScoreOperation::Min})
+	{
+		const FString OperationName = StaticEnum<EUtilityAIScoreOperation>()->GetNameStringByValue(static_cast<int64>(Operation));
+		Benchmarks.Add(FString::Printf(TEXT("CombineScores.%s.%d"), *OperationName, Scores.Num()), [FirstAction, &Scores, Operation](int32 NumIterations)
+		{
+			float Result = 0.f;
+			for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+			{
+				Result += FirstAction->CombineScores(Scores, Operation);
+			}
+			return Result;
+		});
+	}
+
+	Benchmarks.Add(FString::Printf(TEXT("CombineWeightedScores.%d"), Scores.Num()), [&Scores, &Weights](int32 NumIterations)
+	{
+		float Result = 0.f;
+		for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+		{
+			Result += UUtilityAIStatics::CombineWeightedScores(Scores, Weights);
+		}
+		return Result;
+	});
+
+	// uncompiled requirements and tag queries cache their result until the owner's tags change,
+	// so invalidate the owner's tags each iteration to measure the matching itself
+	for (int32 SizeIdx = 0; SizeIdx < RequirementSizes.Num(); ++SizeIdx)
+	{
+		const UUtilityAIAction* Action = Component->GetAction(ActionClasses[SizeIdx]);
+		Benchmarks.Add(FString::Printf(TEXT("AreTagRequirementsMet.RequireTags.%d"), RequirementSizes[SizeIdx]), [Component, Action](int32 NumIterations)
+		{
+			float Result = 0.f;
+			for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+			{
+				Component->InvalidateOwnerTagsForBenchmark();
+				Result += Action->AreTagRequirementsMet() ? 1.f : 0.f;
+			}
+			return Result;
+		});
+	}
+
+	if (!RequirementSizes.IsEmpty())
+	{
+		// compiled requirements are a fixed size bit test, regardless of the number of tags
+		const UUtilityAIAction* Action = Component->GetAction(ActionClasses[RequirementSizes.Num()]);
+		Benchmarks.Add(FString::Printf(TEXT("AreTagRequirementsMet.Compiled.%d"), RequirementSizes.Last()), [Component, Action](int32 NumIterations)
+		{
+			float Result = 0.f;
+			for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+			{
+				Component->InvalidateOwnerTagsForBenchmark();
+				Result += Action->AreTagRequirementsMet() ? 1.f : 0.f;
+			}
+			return Result;
+		});
+	}
+
+	if (!QueryAction->TagQuery.IsEmpty())
+	{
+		Benchmarks.Add(TEXT("AreTagRequirementsMet.TagQuery"), [Component, QueryAction](int32 NumIterations)
+		{
+			float Result = 0.f;
+			for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+			{
+				Component->InvalidateOwnerTagsForBenchmark();
+				Result += QueryAction->AreTagRequirementsMet() ? 1.f : 0.f;
+			}
+			return Result;
+		});
+	}
+
+	Benchmarks.Add(BusyTag.IsValid() ? TEXT("CanActivateAction.Busy") : TEXT("CanActivateAction.NotBusy"), [Component, QueryAction](int32 NumIterations)
+	{
+		float Result = 0.f;
+		for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+		{
+			Result += Component->CanActivateActionForBenchmark(QueryAction) ? 1.f : 0.f;
+		}
+		return Result;
+	});
+
+	for (const bool bCaptureNames : {false, true})
+	{
+		Benchmarks.Add(FString::Printf(TEXT("AddScore.%d%s"), Scores.Num(), bCaptureNames ? TEXT(".Names") : TEXT("")), [&Scores, bCaptureNames](int32 NumIterations)
+		{
+			static const FName ElementName(TEXT("Element"));
+			FUtilityAIScoringElements Elements;
+			Elements.bCaptureNames = bCaptureNames;
+
+			float Result = 0.f;
+			for (int32 Idx = 0; Idx < NumIterations; ++Idx)
+			{
+				Elements.Reset();
+				Elements.bCaptureNames = bCaptureNames;
+				for (const float Score : Scores)
+				{
+					Elements.AddScore(Score, ElementName);
+				}
+				Result += Elements.Scores.Last();
+			}
+			return Result;
+		});
+	}
+
+	Benchmarks.RunAll();
+
+	Component->Deactivate();
+	Controller->Destroy();
+
+	const TSharedRef<FJsonObject> Json = Benchmarks.ToJson();
+	FString JsonString;
+	FJsonSerializer::Serialize(Json, TJsonWriterFactory<>::Create(&JsonString));
+
+	if (!Settings.OutputPath.IsEmpty() && !FFileHelper::SaveStringToFile(JsonString, *Settings.OutputPath))
+	{
+		UE_LOG(LogUtilityAIBenchmark, Error, TEXT("Failed to write results to %s"), *Settings.OutputPath);
+		return 1;
+	}
+
+	if (!Settings.BaselinePath.IsEmpty())
+	{
+		FString BaselineString;
+		TSharedPtr<FJsonObject> Baseline;
+		if (!FFileHelper::LoadFileToString(BaselineString, *Settings.BaselinePath) ||
+			!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), Baseline) || !Baseline)
+		{
+			UE_LOG(LogUtilityAIBenchmark, Error, TEXT("Failed to read baseline from %s"), *Settings.BaselinePath);
+			return 1;
+		}
+
+		int32 NumRegressions = 0;
+		if (!Benchmarks.CompareToBaseline(*Baseline, NumRegressions))
+		{
+			UE_LOG(LogUtilityAIBenchmark, Error, TEXT("%s is not a valid baseline"), *Settings.BaselinePath);
+			return 1;
+		}
+		if (NumRegressions > 0)
+		{
+			UE_LOG(LogUtilityAIBenchmark, Error, TEXT("%d benchmarks regressed by more than %.0f%%"),
+			       NumRegressions, Settings.RegressionThreshold * 100.f);
+			return 1;
+		}
+	}
+	return 0;
+}
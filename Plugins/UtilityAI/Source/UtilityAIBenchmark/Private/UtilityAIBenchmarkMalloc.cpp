@@ -0,0 +1,84 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIBenchmarkMalloc.h"
+
+#include "CoreGlobals.h"
+
+
+thread_local FUtilityAIBenchmarkAllocationCounters* FUtilityAIBenchmarkMalloc::ThreadCounters = nullptr;
+
+bool FUtilityAIBenchmarkMalloc::bIsInstalled = false;
+
+bool FUtilityAIBenchmarkMalloc::Install()
+{
+	check(IsInGameThread());
+	if (bIsInstalled)
+	{
+		return true;
+	}
+
+	// the wrapper can't be removed, so don't slow down every allocation for the rest of an editor session
+	if (!IsRunningCommandlet())
+	{
+		return false;
+	}
+	bIsInstalled = true;
+
+	// never deleted, other threads may hold on to GMalloc at any time
+	GMalloc = new FUtilityAIBenchmarkMalloc(GMalloc);
+	return true;
+}
+
+void* FUtilityAIBenchmarkMalloc::Malloc(SIZE_T Count, uint32 Alignment)
+{
+	void* Result = Inner->Malloc(Count, Alignment);
+	CountAllocation(Result, 0);
+	return Result;
+}
+
+void* FUtilityAIBenchmarkMalloc::TryMalloc(SIZE_T Count, uint32 Alignment)
+{
+	void* Result = Inner->TryMalloc(Count, Alignment);
+	CountAllocation(Result, 0);
+	return Result;
+}
+
+void* FUtilityAIBenchmarkMalloc::Realloc(void* Original, SIZE_T Count, uint32 Alignment)
+{
+	const int64 OriginalSize = ThreadCounters ? GetSize(Original) : 0;
+	void* Result = Inner->Realloc(Original, Count, Alignment);
+	CountAllocation(Result, OriginalSize);
+	return Result;
+}
+
+void* FUtilityAIBenchmarkMalloc::TryRealloc(void* Original, SIZE_T Count, uint32 Alignment)
+{
+	const int64 OriginalSize = ThreadCounters ? GetSize(Original) : 0;
+	void* Result = Inner->TryRealloc(Original, Count, Alignment);
+	CountAllocation(Result, Result ? OriginalSize : 0);
+	return Result;
+}
+
+void FUtilityAIBenchmarkMalloc::Free(void* Original)
+{
+	if (FUtilityAIBenchmarkAllocationCounters* Counters = ThreadCounters)
+	{
+		Counters->FreedBytes += GetSize(Original);
+	}
+	Inner->Free(Original);
+}
+
+void FUtilityAIBenchmarkMalloc::CountAllocation(void* Result, int64 OriginalSize) const
+{
+	FUtilityAIBenchmarkAllocationCounters* Counters = ThreadCounters;
+	if (!Counters || !Result)
+	{
+		return;
+	}
+
+	// a realloc is counted as freeing the original block and allocating a new one
+	++Counters->NumAllocations;
+	Counters->AllocatedBytes += GetSize(Result);
+	Counters->FreedBytes += OriginalSize;
+}
@@ -0,0 +1,106 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+
+
+/** Allocations counted on one thread while a FUtilityAIBenchmarkAllocationScope is active. */
+struct FUtilityAIBenchmarkAllocationCounters
+{
+	/** The number of calls to Malloc or Realloc. */
+	int64 NumAllocations = 0;
+
+	/** The total bytes allocated, not including frees. */
+	int64 AllocatedBytes = 0;
+
+	/** The total bytes freed, including blocks that were allocated before counting started. */
+	int64 FreedBytes = 0;
+};
+
+
+/**
+ * Wraps GMalloc to count the allocations made by threads with an active FUtilityAIBenchmarkAllocationScope.
+ * Once installed it stays installed for the rest of the process, since other threads may still be calling it,
+ * so it is only installed by commandlet processes and never into an editor session.
+ * Allocations on threads that aren't counting are forwarded without any extra work.
+ */
+class FUtilityAIBenchmarkMalloc final : public FMalloc
+{
+public:
+	/** Wrap GMalloc if this is a commandlet, and return true if it is wrapped. Only call this from the game thread. */
+	static bool Install();
+
+	/** The counters of the current thread, if it is counting. */
+	static thread_local FUtilityAIBenchmarkAllocationCounters* ThreadCounters;
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override;
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override;
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override;
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override;
+	virtual void Free(void* Original) override;
+
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+private:
+	explicit FUtilityAIBenchmarkMalloc(FMalloc* InInner)
+		: Inner(InInner)
+	{
+	}
+
+	FMalloc* Inner;
+
+	static bool bIsInstalled;
+
+	int64 GetSize(void* Ptr) const
+	{
+		SIZE_T Size = 0;
+		return Ptr && Inner->GetAllocationSize(Ptr, Size) ? static_cast<int64>(Size) : 0;
+	}
+
+	void CountAllocation(void* Result, int64 OriginalSize) const;
+};
+
+
+/**
+ * Counts the allocations made by the current thread for the lifetime of the scope.
+ * Allocations made by other threads, e.g. task workers, aren't counted, and nothing is counted outside of commandlets.
+ */
+class FUtilityAIBenchmarkAllocationScope
+{
+public:
+	FUtilityAIBenchmarkAllocationScope()
+		: Previous(FUtilityAIBenchmarkMalloc::ThreadCounters),
+		  bIsCounting(FUtilityAIBenchmarkMalloc::Install())
+	{
+		if (bIsCounting)
+		{
+			FUtilityAIBenchmarkMalloc::ThreadCounters = &Counters;
+		}
+	}
+
+	~FUtilityAIBenchmarkAllocationScope()
+	{
+		FUtilityAIBenchmarkMalloc::ThreadCounters = Previous;
+	}
+
+	const FUtilityAIBenchmarkAllocationCounters& Get() const { return Counters; }
+
+	/** Are allocations being counted? If not, the counters stay at 0. */
+	bool IsCounting() const { return bIsCounting; }
+
+private:
+	FUtilityAIBenchmarkAllocationCounters Counters;
+
+	FUtilityAIBenchmarkAllocationCounters* Previous;
+
+	bool bIsCounting;
+};
@@ -0,0 +1,7 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#include "UtilityAIBenchmarkModule.h"
+
+DEFINE_LOG_CATEGORY(LogUtilityAIBenchmark)
+
+IMPLEMENT_MODULE(FUtilityAIBenchmarkModule, UtilityAIBenchmark)
@@ -0,0 +1,152 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIMicroBenchmarks.h"
+
+#include "UtilityAIBenchmarkModule.h"
+#include "Dom/JsonObject.h"
+
+
+void FUtilityAIMicroBenchmarkSettings::Parse(const FString& Params)
+{
+	FParse::Value(*Params, TEXT("WarmupRepetitions="), NumWarmupRepetitions);
+	FParse::Value(*Params, TEXT("Repetitions="), NumRepetitions);
+	FParse::Value(*Params, TEXT("Iterations="), NumIterations);
+	FParse::Value(*Params, TEXT("Threshold="), RegressionThreshold);
+	FParse::Value(*Params, TEXT("Filter="), Filter);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	NumWarmupRepetitions = FMath::Max(NumWarmupRepetitions, 0);
+	NumRepetitions = FMath::Max(NumRepetitions, 1);
+	NumIterations = FMath::Max(NumIterations, 1);
+}
+
+TSharedRef<FJsonObject> FUtilityAIMicroBenchmarkResult::ToJson() const
+{
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("meanNs"), MeanNs);
+	Json->SetNumberField(TEXT("medianNs"), MedianNs);
+	Json->SetNumberField(TEXT("stdDevNs"), StdDevNs);
+	Json->SetNumberField(TEXT("minNs"), MinNs);
+	Json->SetNumberField(TEXT("p95Ns"), P95Ns);
+	return Json;
+}
+
+
+FUtilityAIMicroBenchmarks::FUtilityAIMicroBenchmarks(const FUtilityAIMicroBenchmarkSettings& InSettings)
+	: Settings(InSettings)
+{
+}
+
+void FUtilityAIMicroBenchmarks::Add(const FString& Name, TFunction<float(int32 NumIterations)> Run)
+{
+	Benchmarks.Emplace(Name, MoveTemp(Run));
+}
+
+void FUtilityAIMicroBenchmarks::RunAll()
+{
+	Results.Reset();
+
+	TArray<double> Times;
+	for (const TPair<FString, TFunction<float(int32)>>& Benchmark : Benchmarks)
+	{
+		if (!Settings.Filter.IsEmpty() && !Benchmark.Key.Contains(Settings.Filter))
+		{
+			continue;
+		}
+
+		for (int32 Idx = 0; Idx < Settings.NumWarmupRepetitions; ++Idx)
+		{
+			Sink = Sink + Benchmark.Value(Settings.NumIterations);
+		}
+
+		Times.Reset(Settings.NumRepetitions);
+		for (int32 Idx = 0; Idx < Settings.NumRepetitions; ++Idx)
+		{
+			const double StartTime = FPlatformTime::Seconds();
+			Sink = Sink + Benchmark.Value(Settings.NumIterations);
+			Times.Add((FPlatformTime::Seconds() - StartTime) * 1.0e9 / Settings.NumIterations);
+		}
+		Times.Sort();
+
+		FUtilityAIMicroBenchmarkResult& Result = Results.AddDefaulted_GetRef();
+		Result.Name = Benchmark.Key;
+		for (const double Time : Times)
+		{
+			Result.MeanNs += Time;
+		}
+		Result.MeanNs /= Times.Num();
+		for (const double Time : Times)
+		{
+			Result.StdDevNs += FMath::Square(Time - Result.MeanNs);
+		}
+		Result.StdDevNs = FMath::Sqrt(Result.StdDevNs / Times.Num());
+		Result.MedianNs = Times[Times.Num() / 2];
+		Result.MinNs = Times[0];
+		Result.P95Ns = Times[FMath::Clamp(FMath::CeilToInt32(0.95 * Times.Num()) - 1, 0, Times.Num() - 1)];
+
+		UE_LOG(LogUtilityAIBenchmark, Display, TEXT("%-48s median %10.2f ns  mean %10.2f ns  stddev %8.2f ns  p95 %10.2f ns"),
+		       *Result.Name, Result.MedianNs, Result.MeanNs, Result.StdDevNs, Result.P95Ns);
+	}
+}
+
+bool FUtilityAIMicroBenchmarks::CompareToBaseline(const FJsonObject& Baseline, int32& OutNumRegressions) const
+{
+	OutNumRegressions = 0;
+
+	const TSharedPtr<FJsonObject>* BaselineBenchmarks = nullptr;
+	if (!Baseline.TryGetObjectField(TEXT("benchmarks"), BaselineBenchmarks) || !BaselineBenchmarks->IsValid())
+	{
+		UE_LOG(LogUtilityAIBenchmark, Error, TEXT("Baseline has no benchmarks"));
+		return false;
+	}
+
+	int32 NumCompared = 0;
+	for (const FUtilityAIMicroBenchmarkResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* BaselineResult = nullptr;
+		double BaselineMedianNs = 0.0;
+		if (!(*BaselineBenchmarks)->TryGetObjectField(Result.Name, BaselineResult) ||
+			!(*BaselineResult)->TryGetNumberField(TEXT("medianNs"), BaselineMedianNs) || BaselineMedianNs <= 0.0)
+		{
+			UE_LOG(LogUtilityAIBenchmark, Display, TEXT("%-48s not in baseline"), *Result.Name);
+			continue;
+		}
+		++NumCompared;
+
+		const double Change = Result.MedianNs / BaselineMedianNs - 1.0;
+		if (Change > Settings.RegressionThreshold)
+		{
+			++OutNumRegressions;
+			UE_LOG(LogUtilityAIBenchmark, Error, TEXT("%-48s regressed %+.1f%% (%.2f ns -> %.2f ns)"),
+			       *Result.Name, Change * 100.0, BaselineMedianNs, Result.MedianNs);
+		}
+		else
+		{
+			UE_LOG(LogUtilityAIBenchmark, Display, TEXT("%-48s %+.1f%%"), *Result.Name, Change * 100.0);
+		}
+	}
+
+	// an empty or stale baseline would otherwise let every regression through unnoticed
+	if (NumCompared == 0 && !Results.IsEmpty())
+	{
+		UE_LOG(LogUtilityAIBenchmark, Warning, TEXT("No results were in the baseline, so nothing was checked for regressions"));
+	}
+	return true;
+}
+
+TSharedRef<FJsonObject> FUtilityAIMicroBenchmarks::ToJson() const
+{
+	const TSharedRef<FJsonObject> BenchmarksJson = MakeShared<FJsonObject>();
+	for (const FUtilityAIMicroBenchmarkResult& Result : Results)
+	{
+		BenchmarksJson->SetObjectField(Result.Name, Result.ToJson());
+	}
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetNumberField(TEXT("repetitions"), Settings.NumRepetitions);
+	Json->SetNumberField(TEXT("iterations"), Settings.NumIterations);
+	Json->SetObjectField(TEXT("benchmarks"), BenchmarksJson);
+	return Json;
+}
@@ -0,0 +1,90 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJsonObject;
+
+
+/** Settings for running micro benchmarks, parsed from the command line. */
+struct FUtilityAIMicroBenchmarkSettings
+{
+	/** Repetitions to run and discard before measuring. */
+	int32 NumWarmupRepetitions = 3;
+
+	/** Measured repetitions of each benchmark. */
+	int32 NumRepetitions = 20;
+
+	/** Iterations of the measured operation in each repetition. */
+	int32 NumIterations = 10000;
+
+	/** The fraction a benchmark's median time can exceed its baseline before it is considered a regression. */
+	float RegressionThreshold = 0.1f;
+
+	/** Only run benchmarks whose name contains this, if set. */
+	FString Filter;
+
+	/** A previous results file to compare against, if any. */
+	FString BaselinePath;
+
+	/** The file to write JSON results to, if any. */
+	FString OutputPath;
+
+	void Parse(const FString& Params);
+};
+
+
+/** Timing statistics for a benchmark, in nanoseconds per iteration. */
+struct FUtilityAIMicroBenchmarkResult
+{
+	FString Name;
+	double MeanNs = 0.0;
+	double MedianNs = 0.0;
+	double StdDevNs = 0.0;
+	double MinNs = 0.0;
+	double P95Ns = 0.0;
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+
+/**
+ * Runs small benchmarks of individual functions with warm-up and repetitions,
+ * and compares the results to a baseline from a previous run.
+ */
+class FUtilityAIMicroBenchmarks
+{
+public:
+	explicit FUtilityAIMicroBenchmarks(const FUtilityAIMicroBenchmarkSettings& InSettings);
+
+	/**
+	 * Add a benchmark. Run is called with the number of iterations to perform, and should return a value
+	 * that depends on the work done, so that it can't be optimized away.
+	 */
+	void Add(const FString& Name, TFunction<float(int32 NumIterations)> Run);
+
+	/** Run all added benchmarks that match the filter. */
+	void RunAll();
+
+	/**
+	 * Log the change of each result from a baseline, and count the number of regressions.
+	 * Warns if no results were in the baseline. Returns false if the baseline isn't in the format written by ToJson.
+	 */
+	bool CompareToBaseline(const FJsonObject& Baseline, int32& OutNumRegressions) const;
+
+	/** Return the results as JSON, in the same format expected for baselines. */
+	TSharedRef<FJsonObject> ToJson() const;
+
+	const TArray<FUtilityAIMicroBenchmarkResult>& GetResults() const { return Results; }
+
+private:
+	FUtilityAIMicroBenchmarkSettings Settings;
+
+	TArray<TPair<FString, TFunction<float(int32)>>> Benchmarks;
+
+	TArray<FUtilityAIMicroBenchmarkResult> Results;
+
+	/** Receives the result of each run, to keep the benchmarked work from being optimized away. */
+	volatile float Sink = 0.f;
+};
@@ -0,0 +1,101 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "GameplayTagAssetInterface.h"
+#include "UtilityAIAction.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIBenchmarkAction.generated.h"
+
+
+/**
+ * A synthetic action used for benchmarking, with a configurable score and scoring cost.
+ * The benchmark creates a transient subclass of this for each action in a synthetic action set,
+ * since agents can only have one action of each class.
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UTILITYAIBENCHMARK_API UUtilityAIBenchmarkAction : public UUtilityAIAction
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIBenchmarkAction();
+
+	/** The 0..1 score this action calculates, before jitter. */
+	UPROPERTY()
+	float BaseScore = 0.5f;
+
+	/** The fraction of BaseScore that is randomized each time the score is calculated. */
+	UPROPERTY()
+	float ScoreJitter = 0.1f;
+
+	/** The number of iterations of busy work to do while scoring, to simulate expensive considerations. */
+	UPROPERTY()
+	int32 ScoringCost = 0;
+
+	virtual void Initialize() override;
+	virtual float CalculateCustomScore() override;
+
+	/** Keep executing until interrupted by another action. */
+	virtual void Execute() override;
+
+protected:
+	FRandomStream ScoreRandom;
+};
+
+
+/**
+ * A synthetic data driven action used for benchmarking, scored by considerations created by the benchmark.
+ * Like UUtilityAIBenchmarkAction, the benchmark creates a transient subclass of this for each action.
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UTILITYAIBENCHMARK_API UUtilityAIBenchmarkDataAction : public UUtilityAIAction
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIBenchmarkDataAction();
+
+	/** Keep executing until interrupted by another action. */
+	virtual void Execute() override;
+};
+
+
+/**
+ * A synthetic consideration input with a configurable value and cost, used for benchmarking.
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UTILITYAIBENCHMARK_API UUtilityAIBenchmarkInput : public UUtilityAIConsiderationInput
+{
+	GENERATED_BODY()
+
+public:
+	/** The 0..1 value to return. */
+	UPROPERTY()
+	float Value = 0.5f;
+
+	/** The number of iterations of busy work to do, to simulate an expensive input. */
+	UPROPERTY()
+	int32 Cost = 0;
+
+	virtual float GetValue(const FUtilityAIConsiderationContext& Context) const override;
+	virtual bool IsThreadSafe() const override { return true; }
+};
+
+
+/**
+ * An AI controller with gameplay tags that can be changed directly, used for benchmarking tag requirements.
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UTILITYAIBENCHMARK_API AUtilityAIBenchmarkController : public AAIController, public IGameplayTagAssetInterface
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY()
+	FGameplayTagContainer OwnedTags;
+
+	virtual void GetOwnedGameplayTags(FGameplayTagContainer& TagContainer) const override;
+};
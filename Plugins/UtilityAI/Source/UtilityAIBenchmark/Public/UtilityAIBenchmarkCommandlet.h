@@ -0,0 +1,136 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "Commandlets/Commandlet.h"
+#include "UtilityAITypes.h"
+#include "UtilityAIBenchmarkCommandlet.generated.h"
+
+class FJsonObject;
+class UUtilityAIActionSet;
+class UUtilityAIComponent;
+
+
+/** How scores are distributed between the actions of a synthetic action set. */
+enum class EUtilityAIBenchmarkScoreDistribution : uint8
+{
+	/** Scores are evenly distributed between 0 and 1. */
+	Uniform,
+	/** Most scores are low and a few are high, typical of well designed action sets. */
+	Skewed,
+	/** All scores are nearly equal, the worst case for branch and bound selection. */
+	Flat,
+};
+
+
+/** Settings for a synthetic load benchmark, parsed from the command line. */
+struct FUtilityAIBenchmarkSettings
+{
+	int32 NumAgents = 100;
+	int32 NumActions = 20;
+	int32 NumTicks = 300;
+	int32 NumWarmupTicks = 30;
+	float DeltaTime = 0.025f;
+
+	/** Iterations of busy work done while scoring each action. */
+	int32 ScoringCost = 50;
+
+	/** How synthetic actions are scored. Data actions split their ScoringCost between their considerations. */
+	EUtilityAIScoringMethod ScoringMethod = EUtilityAIScoringMethod::Function;
+
+	/** The number of considerations of each data action, including a tag gate when the project has tags. */
+	int32 NumConsiderationsPerAction = 4;
+
+	/** The number of tags required and ignored by each action. */
+	int32 NumTagsPerAction = 2;
+
+	/** The chance of an agent's tags changing each tick. */
+	float TagChurn = 0.05f;
+
+	EUtilityAIBenchmarkScoreDistribution ScoreDistribution = EUtilityAIBenchmarkScoreDistribution::Skewed;
+	EUtilityAISelectionMode SelectionMode = EUtilityAISelectionMode::BranchAndBound;
+
+	/** Tick agents using the UtilityAISubsystem instead of ticking each component. */
+	bool bUseSubsystemTick = false;
+
+	int32 Seed = 0;
+
+	/** The file to write JSON results to, if any. */
+	FString OutputPath;
+
+	void Parse(const FString& Params);
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+
+/** Results of a synthetic load benchmark. */
+struct FUtilityAIBenchmarkResults
+{
+	double MeanTickMs = 0.0;
+	double P99TickMs = 0.0;
+	double MaxTickMs = 0.0;
+	double MeanAgentUs = 0.0;
+	/** Were allocations counted? They are only counted when running as a commandlet, not from editor automation. */
+	bool bHasAllocations = false;
+	/** Allocations made on the game thread, not including task workers. */
+	double AllocationsPerTick = 0.0;
+	double AllocatedBytesPerTick = 0.0;
+	double MemoryPerAgentBytes = 0.0;
+	double ActionsScoredPerTick = 0.0;
+
+	TSharedRef<FJsonObject> ToJson() const;
+};
+
+
+/**
+ * Measures the cost of utility AI decision making under synthetic load, without loading a map.
+ * Spawns agents with synthetic action sets in an empty world, runs fixed-step ticks, and reports JSON results.
+ *
+ * Usage: UnrealEditor-Cmd <Project> -run=UtilityAIBenchmark -Agents=100 -Actions=20 -Ticks=300 -Output=Results.json
+ * Other options: -WarmupTicks, -DeltaTime, -ScoringCost, -ScoringMethod=Function|Data, -Considerations, -TagsPerAction,
+ * -TagChurn, -Distribution=Uniform|Skewed|Flat, -SelectionMode=Exhaustive|BranchAndBound, -Subsystem, -Seed
+ *
+ * With -Micro, benchmarks individual scoring functions instead, and returns an error if any regressed from a baseline.
+ * Usage: UnrealEditor-Cmd <Project> -run=UtilityAIBenchmark -Micro -Baseline=Baseline.json -Output=Results.json
+ * Other options: -WarmupRepetitions, -Repetitions, -Iterations, -Threshold=0.1, -Filter
+ */
+UCLASS()
+class UTILITYAIBENCHMARK_API UUtilityAIBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/** Create an action set with a transient action class for each action. */
+	UUtilityAIActionSet* CreateActionSet(const FUtilityAIBenchmarkSettings& Settings, TConstArrayView<FGameplayTag> Tags, FRandomStream& Random);
+
+	/** Set up the considerations of a synthetic data action. */
+	void CreateConsiderations(const FUtilityAIBenchmarkSettings& Settings, UUtilityAIAction* DefaultAction, float BaseScore,
+	                          TConstArrayView<FGameplayTag> Tags, FRandomStream& Random);
+
+	/** Create a transient subclass of a benchmark action, so that each action in a set has a unique class. */
+	UClass* CreateActionClass(UClass* SuperClass, int32 Index);
+
+	/** Spawn agents, tick them, and measure the results. */
+	void RunBenchmark(UWorld* World, const FUtilityAIBenchmarkSettings& Settings, FUtilityAIBenchmarkResults& OutResults);
+
+	/** Run micro benchmarks of individual functions, returning the commandlet exit code. */
+	int32 RunMicroBenchmarks(UWorld* World, const FString& Params);
+
+	/** Return up to MaxTags of the project's gameplay tags. */
+	static TArray<FGameplayTag> GetBenchmarkTags();
+
+	/** Function action classes created so far, reused between runs. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UClass>> ActionClasses;
+
+	/** Data action classes created so far, reused between runs. */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UClass>> DataActionClasses;
+};
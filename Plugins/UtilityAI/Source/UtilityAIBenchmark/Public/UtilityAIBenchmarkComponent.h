@@ -0,0 +1,51 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UtilityAIComponent.h"
+#include "UtilityAIBenchmarkComponent.generated.h"
+
+
+/**
+ * A UtilityAIComponent that exposes protected functions so they can be benchmarked directly.
+ */
+UCLASS(Transient, NotBlueprintable, HideDropdown)
+class UTILITYAIBENCHMARK_API UUtilityAIBenchmarkComponent : public UUtilityAIComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Make an action current, as if it had been selected. Fails if the AI is busy. */
+	void SetCurrentActionForBenchmark(UUtilityAIAction* Action)
+	{
+		UpdateScoringSnapshot();
+		TryActivateAction(Action);
+	}
+
+	/** Capture a new scoring snapshot, e.g. after changing the AIController's tags. */
+	void UpdateScoringSnapshotForBenchmark()
+	{
+		UpdateScoringSnapshot();
+	}
+
+	/** Forget the compiled tag requirements of an action, so that they are matched against the owner's tags instead. */
+	void ClearCompiledTagRequirementsForBenchmark(TSubclassOf<UUtilityAIAction> ActionClass)
+	{
+		if (const int32* ActionIdx = ActionIndicesByClass.Find(ActionClass.Get()))
+		{
+			ActionSlots[*ActionIdx].bHasCompiledTagRequirements = false;
+		}
+	}
+
+	/** Make actions treat the owner's tags as changed, without capturing a new snapshot, so cached tag checks are repeated. */
+	void InvalidateOwnerTagsForBenchmark()
+	{
+		++OwnerTagsSerial;
+	}
+
+	bool CanActivateActionForBenchmark(UUtilityAIAction* Action)
+	{
+		return CanActivateAction(Action);
+	}
+};
@@ -0,0 +1,12 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogUtilityAIBenchmark, Log, All);
+
+class FUtilityAIBenchmarkModule : public IModuleInterface
+{
+};
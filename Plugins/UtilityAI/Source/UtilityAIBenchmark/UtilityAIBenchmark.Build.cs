@@ -0,0 +1,32 @@
+// Copyright Bohdon Sayre. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class UtilityAIBenchmark : ModuleRules
+{
+	public UtilityAIBenchmark(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"AIModule",
+				"GameplayTags",
+				"UtilityAI",
+			}
+		);
+
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"CoreUObject",
+				"Engine",
+				"Json",
+				"Projects",
+			}
+		);
+	}
+}
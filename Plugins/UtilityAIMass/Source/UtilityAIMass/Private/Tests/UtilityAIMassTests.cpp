@@ -0,0 +1,103 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "CoreMinimal.h"
+#include "MassEntityManager.h"
+#include "MassExecutor.h"
+#include "MassProcessingTypes.h"
+#include "UtilityAIAction.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIMassFragments.h"
+#include "UtilityAIMassProcessor.h"
+#include "Considerations/UtilityAIInput_ActionTime.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/StrongObjectPtr.h"
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace UtilityAIMassTests
+{
+	/** Return a thread-safe consideration that always scores Score. */
+	const UUtilityAIConsideration* CreateConstantConsideration(float Score)
+	{
+		UUtilityAIConsideration* Consideration = NewObject<UUtilityAIConsideration>(GetTransientPackage());
+		Consideration->Input = NewObject<UUtilityAIInput_ActionTime>(Consideration);
+		Consideration->ResponseCurve.Slope = 0.f;
+		Consideration->ResponseCurve.YShift = Score;
+		return Consideration;
+	}
+
+	FUtilityAIMassAction CreateAction(float ScoreWeight, TConstArrayView<float> Scores)
+	{
+		FUtilityAIMassAction Action;
+		Action.DefaultAction = GetDefault<UUtilityAIAction>();
+		Action.ScoreWeight = ScoreWeight;
+		for (const float Score : Scores)
+		{
+			Action.Considerations.Add(CreateConstantConsideration(Score));
+		}
+		Action.bHasCompiledTagRequirements = true;
+		return Action;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FUtilityAIMassSelectActionTest, "UtilityAI.Mass.SelectAction",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FUtilityAIMassSelectActionTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 NumEntities = 16;
+	constexpr int32 ExpectedActionIdx = 1;
+
+	// sorted by descending weight, as built by FUtilityAIMassActionSetFragment::Initialize
+	FUtilityAIMassActionSetFragment ActionSet;
+	ActionSet.DecisionInterval = 0.f;
+	// 1.0 * 1.0 * 0.2 = 0.2, the heaviest action loses to a failing consideration
+	ActionSet.Actions.Add(UtilityAIMassTests::CreateAction(1.f, {1.f, 0.2f}));
+	// 0.8 * 0.5 = 0.4, the best score
+	ActionSet.Actions.Add(UtilityAIMassTests::CreateAction(0.8f, {0.5f}));
+	// 0.3 * 1.0 = 0.3, can't beat the best score and is never scored
+	ActionSet.Actions.Add(UtilityAIMassTests::CreateAction(0.3f, {1.f}));
+
+	const TSharedRef<FMassEntityManager> EntityManager = MakeShared<FMassEntityManager>();
+	EntityManager->Initialize();
+
+	const FMassArchetypeHandle Archetype = EntityManager->CreateArchetype({
+		FUtilityAIMassStateFragment::StaticStruct(),
+		FUtilityAIMassTagsFragment::StaticStruct(),
+	});
+
+	FMassArchetypeSharedFragmentValues SharedValues;
+	SharedValues.AddConstSharedFragment(EntityManager->GetOrCreateConstSharedFragment(ActionSet));
+	SharedValues.Sort();
+
+	TArray<FMassEntityHandle> Entities;
+	EntityManager->BatchCreateEntities(Archetype, SharedValues, NumEntities, Entities);
+
+	for (const FMassEntityHandle Entity : Entities)
+	{
+		FUtilityAIMassStateFragment& State = EntityManager->GetFragmentDataChecked<FUtilityAIMassStateFragment>(Entity);
+		State.NextDecisionTime = 0.0;
+		State.ActionStates.SetNum(ActionSet.Actions.Num());
+	}
+
+	// run without a world, the same as headless automation
+	const TStrongObjectPtr<UUtilityAIMassProcessor> Processor(NewObject<UUtilityAIMassProcessor>());
+	Processor->CallInitialize(GetTransientPackage());
+	FMassProcessingContext ProcessingContext(EntityManager, 0.f);
+	UE::Mass::Executor::Run(*Processor, ProcessingContext);
+
+	for (const FMassEntityHandle Entity : Entities)
+	{
+		const FUtilityAIMassStateFragment& State = EntityManager->GetFragmentDataChecked<FUtilityAIMassStateFragment>(Entity);
+		TestEqual(TEXT("Selected action"), State.CurrentActionIndex, ExpectedActionIdx);
+		TestTrue(TEXT("Selected action is executing"), State.ActionStates[ExpectedActionIdx].bIsExecuting);
+		TestEqual(TEXT("Lightest action score"), State.ActionStates[2].Score, 0.f);
+	}
+
+	return true;
+}
+
+#endif
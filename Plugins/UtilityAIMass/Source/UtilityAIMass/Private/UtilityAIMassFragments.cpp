@@ -0,0 +1,92 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIMassFragments.h"
+
+#include "UtilityAIAction.h"
+#include "UtilityAIActionSet.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIMassModule.h"
+
+
+void FUtilityAIMassActionSetFragment::Initialize(const UUtilityAIActionSet& InActionSet)
+{
+	ActionSet = &InActionSet;
+	Actions.Reset();
+	TagTable.Reset();
+
+	const auto CompileTags = [this](const FGameplayTagContainer& Tags, FUtilityAITagBits& OutBits)
+	{
+		OutBits.Reset();
+		for (const FGameplayTag& Tag : Tags)
+		{
+			const int32 Index = TagTable.AddUnique(Tag);
+			if (Index >= FUtilityAITagBits::NumBits)
+			{
+				TagTable.Pop(EAllowShrinking::No);
+				return false;
+			}
+			OutBits.SetBit(Index);
+		}
+		return true;
+	};
+
+	for (const auto& Elem : InActionSet.Actions)
+	{
+		const UUtilityAIAction* DefaultAction = Elem.Key ? Elem.Key->GetDefaultObject<UUtilityAIAction>() : nullptr;
+		if (!DefaultAction)
+		{
+			continue;
+		}
+
+		// agents are scored from worker threads and have no action instances
+		if (DefaultAction->ScoringMethod != EUtilityAIScoringMethod::Data)
+		{
+			UE_LOG(LogUtilityAIMass, Warning, TEXT("%s: %s doesn't use data scoring and can't be used by Mass agents"),
+			       *InActionSet.GetName(), *Elem.Key->GetName());
+			continue;
+		}
+
+		FUtilityAIMassAction Action;
+		Action.DefaultAction = DefaultAction;
+		Action.ScoreWeight = Elem.Value;
+		Action.ConsiderationOperation = DefaultAction->ConsiderationOperation;
+		Action.RequireTags = DefaultAction->RequireTags;
+		Action.IgnoreTags = DefaultAction->IgnoreTags;
+		Action.TagQuery = DefaultAction->TagQuery;
+
+		bool bAreConsiderationsThreadSafe = true;
+		for (const UUtilityAIConsideration* Consideration : DefaultAction->Considerations)
+		{
+			if (Consideration)
+			{
+				bAreConsiderationsThreadSafe &= Consideration->IsThreadSafe();
+				Action.Considerations.Add(Consideration);
+			}
+		}
+		if (!bAreConsiderationsThreadSafe)
+		{
+			UE_LOG(LogUtilityAIMass, Warning, TEXT("%s: %s has considerations that aren't thread-safe and can't be used by Mass agents"),
+			       *InActionSet.GetName(), *Elem.Key->GetName());
+			continue;
+		}
+
+		// evaluate cheap considerations first, so failing gates can skip more expensive checks
+		Action.Considerations.StableSort([](const TObjectPtr<const UUtilityAIConsideration>& A, const TObjectPtr<const UUtilityAIConsideration>& B)
+		{
+			return A->Cost < B->Cost;
+		});
+
+		Action.bHasCompiledTagRequirements = Action.TagQuery.IsEmpty() &&
+			CompileTags(Action.RequireTags, Action.RequireTagBits) &&
+			CompileTags(Action.IgnoreTags, Action.IgnoreTagBits);
+
+		Actions.Add(MoveTemp(Action));
+	}
+
+	// heaviest first, so selection can stop once the remaining weights can't beat the best score
+	Actions.StableSort([](const FUtilityAIMassAction& A, const FUtilityAIMassAction& B)
+	{
+		return A.ScoreWeight > B.ScoreWeight;
+	});
+}
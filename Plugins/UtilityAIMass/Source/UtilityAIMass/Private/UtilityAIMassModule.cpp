@@ -0,0 +1,7 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#include "UtilityAIMassModule.h"
+
+DEFINE_LOG_CATEGORY(LogUtilityAIMass)
+
+IMPLEMENT_MODULE(FUtilityAIMassModule, UtilityAIMass)
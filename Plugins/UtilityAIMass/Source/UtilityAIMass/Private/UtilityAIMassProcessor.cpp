@@ -0,0 +1,208 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIMassProcessor.h"
+
+#include "MassCommonFragments.h"
+#include "MassExecutionContext.h"
+#include "UtilityAIConsideration.h"
+#include "UtilityAIMassFragments.h"
+#include "UtilityAIScoringSnapshot.h"
+#include "Engine/World.h"
+
+
+UUtilityAIMassProcessor::UUtilityAIMassProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::All);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	bAutoRegisterWithProcessingPhases = true;
+
+	// only thread-safe considerations are used
+	bRequiresGameThreadExecution = false;
+}
+
+void UUtilityAIMassProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FUtilityAIMassStateFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FUtilityAIMassTagsFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+	EntityQuery.AddConstSharedRequirement<FUtilityAIMassActionSetFragment>();
+}
+
+void UUtilityAIMassProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	const UWorld* World = Context.GetWorld();
+	const double WorldTime = World ? World->GetTimeSeconds() : 0.0;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [WorldTime](FMassExecutionContext& Context)
+	{
+		const FUtilityAIMassActionSetFragment& ActionSet = Context.GetConstSharedFragment<FUtilityAIMassActionSetFragment>();
+		const TArrayView<FUtilityAIMassStateFragment> States = Context.GetMutableFragmentView<FUtilityAIMassStateFragment>();
+		const TConstArrayView<FUtilityAIMassTagsFragment> TagsList = Context.GetFragmentView<FUtilityAIMassTagsFragment>();
+		const TConstArrayView<FTransformFragment> Transforms = Context.GetFragmentView<FTransformFragment>();
+
+		// reused for every agent in the chunk
+		FUtilityAIScoringSnapshot Snapshot;
+		Snapshot.WorldTime = WorldTime;
+		Snapshot.bHasPawn = false;
+
+		for (int32 EntityIdx = 0; EntityIdx < Context.GetNumEntities(); ++EntityIdx)
+		{
+			FUtilityAIMassStateFragment& State = States[EntityIdx];
+			if (WorldTime < State.NextDecisionTime || State.ActionStates.Num() != ActionSet.Actions.Num())
+			{
+				continue;
+			}
+			State.NextDecisionTime = WorldTime + ActionSet.DecisionInterval;
+
+			const FGameplayTagContainer& OwnerTags = TagsList[EntityIdx].Tags;
+			Snapshot.OwnerTags = OwnerTags;
+			if (!Transforms.IsEmpty())
+			{
+				const FTransform& Transform = Transforms[EntityIdx].GetTransform();
+				Snapshot.PawnLocation = Transform.GetLocation();
+				Snapshot.PawnRotation = Transform.Rotator();
+			}
+
+			// compile the agent's tags once, so each action's requirements are a few bit operations
+			FUtilityAITagBits OwnerTagBits;
+			for (int32 TagIdx = 0; TagIdx < ActionSet.TagTable.Num(); ++TagIdx)
+			{
+				if (OwnerTags.HasTag(ActionSet.TagTable[TagIdx]))
+				{
+					OwnerTagBits.SetBit(TagIdx);
+				}
+			}
+
+			const auto AreTagRequirementsMet = [&](const FUtilityAIMassAction& Action)
+			{
+				if (Action.bHasCompiledTagRequirements)
+				{
+					return OwnerTagBits.HasAll(Action.RequireTagBits) && !OwnerTagBits.HasAny(Action.IgnoreTagBits);
+				}
+				return OwnerTags.HasAll(Action.RequireTags) && !OwnerTags.HasAny(Action.IgnoreTags) &&
+					(Action.TagQuery.IsEmpty() || Action.TagQuery.Matches(OwnerTags));
+			};
+
+			int32 BestActionIdx = INDEX_NONE;
+			const auto GetScoreToBeat = [&]()
+			{
+				if (BestActionIdx == INDEX_NONE)
+				{
+					return 0.f;
+				}
+				const float Hysteresis = BestActionIdx == State.CurrentActionIndex ? ActionSet.ScoreHysteresisThreshold : 0.f;
+				return State.ActionStates[BestActionIdx].Score + Hysteresis;
+			};
+
+			const auto ScoreAndCompareAction = [&](int32 ActionIdx)
+			{
+				const FUtilityAIMassAction& Action = ActionSet.Actions[ActionIdx];
+				FUtilityAIActionState& ActionState = State.ActionStates[ActionIdx];
+
+				const float ScoreToBeat = GetScoreToBeat();
+				if (!AreTagRequirementsMet(Action))
+				{
+					ActionState.Score = 0.f;
+					return;
+				}
+
+				const FUtilityAIConsiderationContext ConsiderationContext(*Action.DefaultAction, &Snapshot, &ActionState);
+				ActionState.Score = ScoreAction(Action, ConsiderationContext, ScoreToBeat);
+				if (ActionState.Score > UE_SMALL_NUMBER && (BestActionIdx == INDEX_NONE || ActionState.Score > ScoreToBeat))
+				{
+					BestActionIdx = ActionIdx;
+				}
+			};
+
+			// score the current action first, so it keeps its hysteresis advantage regardless of its weight
+			if (State.CurrentActionIndex != INDEX_NONE)
+			{
+				ScoreAndCompareAction(State.CurrentActionIndex);
+			}
+
+			for (int32 ActionIdx = 0; ActionIdx < ActionSet.Actions.Num(); ++ActionIdx)
+			{
+				if (ActionIdx == State.CurrentActionIndex)
+				{
+					continue;
+				}
+
+				// actions are sorted by weight, so neither this nor any remaining action can be selected
+				if (BestActionIdx != INDEX_NONE && ActionSet.Actions[ActionIdx].ScoreWeight <= GetScoreToBeat())
+				{
+					break;
+				}
+
+				ScoreAndCompareAction(ActionIdx);
+			}
+
+			if (BestActionIdx != State.CurrentActionIndex)
+			{
+				if (State.CurrentActionIndex != INDEX_NONE)
+				{
+					FUtilityAIActionState& PreviousState = State.ActionStates[State.CurrentActionIndex];
+					PreviousState.bIsExecuting = false;
+					PreviousState.LastFinishTime = WorldTime;
+				}
+				if (BestActionIdx != INDEX_NONE)
+				{
+					FUtilityAIActionState& NewState = State.ActionStates[BestActionIdx];
+					NewState.bIsExecuting = true;
+					NewState.LastExecuteTime = WorldTime;
+					++NewState.ExecuteCount;
+				}
+				State.CurrentActionIndex = BestActionIdx;
+			}
+		}
+	});
+}
+
+float UUtilityAIMassProcessor::ScoreAction(const FUtilityAIMassAction& Action, const FUtilityAIConsiderationContext& Context, float ScoreToBeat)
+{
+	FUtilityAIScoreCombiner Combiner(Action.ConsiderationOperation, Action.ScoreWeight, ScoreToBeat);
+	for (const UUtilityAIConsideration* Consideration : Action.Considerations)
+	{
+		if (Combiner.Add(Consideration->Evaluate(Context)))
+		{
+			break;
+		}
+	}
+
+	return Combiner.GetResult() * Action.ScoreWeight;
+}
+
+
+UUtilityAIMassInitializer::UUtilityAIMassInitializer()
+	: EntityQuery(*this)
+{
+	ObservedType = FUtilityAIMassStateFragment::StaticStruct();
+	Operation = EMassObservedOperation::Add;
+	bRequiresGameThreadExecution = false;
+}
+
+void UUtilityAIMassInitializer::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FUtilityAIMassStateFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddConstSharedRequirement<FUtilityAIMassActionSetFragment>();
+}
+
+void UUtilityAIMassInitializer::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	const UWorld* World = Context.GetWorld();
+	const double WorldTime = World ? World->GetTimeSeconds() : 0.0;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [WorldTime](FMassExecutionContext& Context)
+	{
+		const FUtilityAIMassActionSetFragment& ActionSet = Context.GetConstSharedFragment<FUtilityAIMassActionSetFragment>();
+		const TArrayView<FUtilityAIMassStateFragment> States = Context.GetMutableFragmentView<FUtilityAIMassStateFragment>();
+
+		for (int32 EntityIdx = 0; EntityIdx < Context.GetNumEntities(); ++EntityIdx)
+		{
+			// spread by the golden ratio of the entity index, which is deterministic and evenly distributed
+			const double Offset = FMath::Frac(static_cast<double>(Context.GetEntity(EntityIdx).Index) * UE_DOUBLE_GOLDEN_RATIO);
+			States[EntityIdx].NextDecisionTime = WorldTime + Offset * ActionSet.DecisionInterval;
+		}
+	});
+}
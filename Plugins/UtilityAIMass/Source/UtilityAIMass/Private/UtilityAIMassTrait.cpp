@@ -0,0 +1,33 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+
+#include "UtilityAIMassTrait.h"
+
+#include "MassEntityTemplateRegistry.h"
+#include "MassEntityUtils.h"
+#include "UtilityAIMassFragments.h"
+#include "UtilityAIMassModule.h"
+
+
+void UUtilityAIMassTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	if (!ActionSet)
+	{
+		UE_LOG(LogUtilityAIMass, Warning, TEXT("%s: No action set, Utility AI fragments will not be added"), *GetName());
+		return;
+	}
+
+	FMassEntityManager& EntityManager = UE::Mass::Utils::GetEntityManagerChecked(World);
+
+	FUtilityAIMassActionSetFragment ActionSetFragment;
+	ActionSetFragment.Initialize(*ActionSet);
+	ActionSetFragment.ScoreHysteresisThreshold = ScoreHysteresisThreshold;
+	ActionSetFragment.DecisionInterval = DecisionInterval;
+
+	// template values are shared by every agent, so the first decision is staggered per agent by UUtilityAIMassInitializer
+	FUtilityAIMassStateFragment& State = BuildContext.AddFragment_GetRef<FUtilityAIMassStateFragment>();
+	State.ActionStates.SetNum(ActionSetFragment.Actions.Num());
+
+	BuildContext.AddFragment<FUtilityAIMassTagsFragment>();
+	BuildContext.AddConstSharedFragment(EntityManager.GetOrCreateConstSharedFragment(ActionSetFragment));
+}
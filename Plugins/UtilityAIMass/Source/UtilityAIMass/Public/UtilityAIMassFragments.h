@@ -0,0 +1,122 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "MassEntityTypes.h"
+#include "UtilityAITypes.h"
+#include "UtilityAIMassFragments.generated.h"
+
+class UUtilityAIAction;
+class UUtilityAIActionSet;
+class UUtilityAIConsideration;
+
+
+/**
+ * An action as scored by Mass agents. Mass agents don't instance actions, so only data driven actions
+ * with thread-safe considerations are supported, scored using the action's class defaults.
+ */
+USTRUCT()
+struct UTILITYAIMASS_API FUtilityAIMassAction
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<const UUtilityAIAction> DefaultAction;
+
+	UPROPERTY()
+	float ScoreWeight = 1.f;
+
+	/** The action's considerations, sorted by ascending cost. */
+	UPROPERTY()
+	TArray<TObjectPtr<const UUtilityAIConsideration>> Considerations;
+
+	UPROPERTY()
+	EUtilityAIScoreOperation ConsiderationOperation = EUtilityAIScoreOperation::Multiply;
+
+	UPROPERTY()
+	FGameplayTagContainer RequireTags;
+
+	UPROPERTY()
+	FGameplayTagContainer IgnoreTags;
+
+	UPROPERTY()
+	FGameplayTagQuery TagQuery;
+
+	/** RequireTags compiled against the action set's tag table. */
+	FUtilityAITagBits RequireTagBits;
+
+	/** IgnoreTags compiled against the action set's tag table. */
+	FUtilityAITagBits IgnoreTagBits;
+
+	/** Can tag requirements be checked using only the compiled bits? */
+	bool bHasCompiledTagRequirements = false;
+};
+
+
+/**
+ * The actions available to a group of Mass agents, built from a UUtilityAIActionSet and shared by every agent using it.
+ */
+USTRUCT()
+struct UTILITYAIMASS_API FUtilityAIMassActionSetFragment : public FMassConstSharedFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<const UUtilityAIActionSet> ActionSet;
+
+	/** The supported actions from the set, sorted by descending score weight. */
+	UPROPERTY()
+	TArray<FUtilityAIMassAction> Actions;
+
+	/** Every tag used by the tag requirements of actions. The index of each tag is its bit in FUtilityAITagBits. */
+	UPROPERTY()
+	TArray<FGameplayTag> TagTable;
+
+	/** Actions must be higher than this threshold above the current action in order to be selected. */
+	UPROPERTY()
+	float ScoreHysteresisThreshold = 0.1f;
+
+	/** The time in seconds between decisions for each agent. */
+	UPROPERTY()
+	float DecisionInterval = 0.25f;
+
+	/** Build the actions from an action set, skipping any that can't be scored by Mass agents. */
+	void Initialize(const UUtilityAIActionSet& InActionSet);
+};
+
+
+/**
+ * The tags of a Mass agent, used for tag requirements and as the scoring snapshot's owner tags.
+ */
+USTRUCT()
+struct UTILITYAIMASS_API FUtilityAIMassTagsFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FGameplayTagContainer Tags;
+};
+
+
+/**
+ * The utility state of a Mass agent. Other processors can read CurrentActionIndex to carry out the selected action.
+ */
+USTRUCT()
+struct UTILITYAIMASS_API FUtilityAIMassStateFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	/** The index of the selected action in the shared action set fragment, or INDEX_NONE. */
+	UPROPERTY()
+	int32 CurrentActionIndex = INDEX_NONE;
+
+	/** The world time when the next decision should be made. The first decision is staggered by UUtilityAIMassInitializer. */
+	UPROPERTY()
+	double NextDecisionTime = 0.0;
+
+	/** The runtime state of each action, indexed the same as the shared action set fragment. */
+	UPROPERTY()
+	TArray<FUtilityAIActionState> ActionStates;
+};
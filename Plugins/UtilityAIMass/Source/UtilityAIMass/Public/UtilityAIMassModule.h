@@ -0,0 +1,12 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogUtilityAIMass, Log, All);
+
+class FUtilityAIMassModule : public IModuleInterface
+{
+};
@@ -0,0 +1,54 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassObserverProcessor.h"
+#include "MassProcessor.h"
+#include "UtilityAIMassProcessor.generated.h"
+
+struct FUtilityAIConsiderationContext;
+struct FUtilityAIMassAction;
+
+
+/**
+ * Scores and selects actions for Mass agents with the Utility AI trait, one chunk of agents at a time.
+ * Doesn't require the game thread, a pawn, or a controller, so it also runs in headless automation.
+ */
+UCLASS()
+class UTILITYAIMASS_API UUtilityAIMassProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIMassProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	/** Return the weighted score of an action, or 0 once it is known not to exceed ScoreToBeat. */
+	static float ScoreAction(const FUtilityAIMassAction& Action, const FUtilityAIConsiderationContext& Context, float ScoreToBeat);
+
+	FMassEntityQuery EntityQuery;
+};
+
+
+/**
+ * Staggers the first decision of new Mass agents across their decision interval,
+ * so agents spawned together don't all decide on the same frame.
+ */
+UCLASS()
+class UTILITYAIMASS_API UUtilityAIMassInitializer : public UMassObserverProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UUtilityAIMassInitializer();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
@@ -0,0 +1,35 @@
+﻿// Copyright Bohdon Sayre. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "UtilityAIMassTrait.generated.h"
+
+class UUtilityAIActionSet;
+
+
+/**
+ * Adds utility AI decision making to Mass agents, selecting actions from an action set.
+ * Only data driven actions with thread-safe considerations are supported.
+ */
+UCLASS(meta = (DisplayName = "Utility AI"))
+class UTILITYAIMASS_API UUtilityAIMassTrait : public UMassEntityTraitBase
+{
+	GENERATED_BODY()
+
+public:
+	/** The actions available to agents. */
+	UPROPERTY(EditAnywhere, Category = "Utility AI")
+	TObjectPtr<UUtilityAIActionSet> ActionSet;
+
+	/** Actions must be higher than this threshold above the current action in order to be selected. */
+	UPROPERTY(EditAnywhere, Category = "Utility AI", meta = (ClampMin = 0))
+	float ScoreHysteresisThreshold = 0.1f;
+
+	/** The time in seconds between decisions for each agent. */
+	UPROPERTY(EditAnywhere, Category = "Utility AI", meta = (ClampMin = 0))
+	float DecisionInterval = 0.25f;
+
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+};
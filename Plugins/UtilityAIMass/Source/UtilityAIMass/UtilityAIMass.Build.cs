@@ -0,0 +1,32 @@
+// Copyright Bohdon Sayre. All Rights Reserved.
+
+using UnrealBuildTool;
+
+public class UtilityAIMass : ModuleRules
+{
+	public UtilityAIMass(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+				"GameplayTags",
+				"MassEntity",
+				"MassSpawner",
+				"UtilityAI",
+			}
+		);
+
+
+		PrivateDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"CoreUObject",
+				"Engine",
+				"MassCommon",
+			}
+		);
+	}
+}